@@ -3,14 +3,19 @@
 #include "wshttp/address.hpp"
 #include "wshttp/concepts.hpp"
 #include "wshttp/context.hpp"
+#include "wshttp/coro.hpp"
 #include "wshttp/dns.hpp"
 #include "wshttp/endpoint.hpp"
 // #include "wshttp/format.hpp"
+#include "wshttp/job.hpp"
 #include "wshttp/listener.hpp"
 #include "wshttp/loop.hpp"
 #include "wshttp/node.hpp"
+#include "wshttp/queue.hpp"
 #include "wshttp/request.hpp"
 #include "wshttp/session.hpp"
+#include "wshttp/stats.hpp"
 #include "wshttp/stream.hpp"
+#include "wshttp/timer.hpp"
 #include "wshttp/types.hpp"
 #include "wshttp/utils.hpp"
@@ -2,6 +2,8 @@
 
 #include "types.hpp"
 
+#include <atomic>
+
 namespace wshttp
 {
     class endpoint;
@@ -29,6 +31,129 @@ namespace wshttp
         const fs::path _certfile;
     };
 
+    /** Encryption keys for the session tickets handed to inbound clients, generated at random and held in memory only.
+
+        The newest key encrypts new tickets; it and the `retained - 1` before it decrypt tickets presented back, each of
+        which is renewed under the newest. A fresh key is rotated in every `interval`, which bounds a ticket's
+        lifetime to `interval * (retained - 1)` at least and `interval * retained` at most. One set may be shared by
+        every endpoint in the process: all their listeners and loop shards then accept each other's tickets, and
+        whichever endpoint's timer first finds the newest key due rotates it (see `rotate_if_due`). Lock-free for
+        readers, who hold on to the set they loaded.
+     */
+    class ticket_keys
+    {
+        friend struct ctx_callbacks;
+
+        struct key
+        {
+            std::array<unsigned char, 16> name;
+            std::array<unsigned char, 32> aes;
+            std::array<unsigned char, 32> hmac;
+        };
+
+        ticket_keys(std::chrono::seconds interval, size_t retained);
+
+      public:
+        [[nodiscard]] static std::shared_ptr<ticket_keys> make(
+            std::chrono::seconds interval = 1h, size_t retained = 2);
+
+        // Rotates in a fresh key unconditionally
+        void rotate();
+
+        // Rotates in a fresh key if the newest one is at least `interval` old; returns whether it did
+        bool rotate_if_due();
+
+        std::chrono::seconds interval() const { return _interval; }
+
+        // Lifetime that tickets are advertised with, and guaranteed to be accepted for
+        std::chrono::seconds ticket_lifetime() const { return _interval * static_cast<int64_t>(_retained - 1); }
+
+        uint64_t rotations() const { return _rotations.load(std::memory_order_relaxed); }
+
+      private:
+        const std::chrono::seconds _interval;
+        const size_t _retained;
+
+        // newest first; replaced wholesale on rotation
+        std::atomic<std::shared_ptr<const std::vector<key>>> _keys;
+        std::atomic<std::chrono::steady_clock::rep> _rotated_at;
+        std::atomic<uint64_t> _rotations{0};
+
+        // OpenSSL ticket key callback: sets up `cctx`/`hctx` to encrypt a new ticket (`enc`) or decrypt one named
+        // `name`. Returns 1 if done, 2 if the ticket should be renewed, 0 for an unknown key and -1 on errors
+        int crypt(unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cctx, EVP_MAC_CTX* hctx, int enc) const;
+    };
+
+    /** TLS session resumption of the endpoint's sessions; pass as an endpoint option to override the defaults.
+
+        Outbound sessions cache the sessions (TLS 1.3 tickets, or TLS 1.2 session tickets/IDs) servers hand them, up to
+        `client_sessions` of them keyed by host:port, and offer the cached one on the next connect to the same host so
+        that it can skip the full handshake. Zero disables the cache.
+
+        Inbound sessions hand out stateless session tickets encrypted with `keys`; the endpoint makes its own set if
+        none is given, and rotates it on its loop either way. For clients that resume by session ID instead, up to
+        `server_sessions` sessions are also kept server-side; zero (the default) keeps none.
+     */
+    struct tls_resumption
+    {
+        size_t client_sessions{256};
+        std::shared_ptr<ticket_keys> keys;
+        size_t server_sessions{0};
+    };
+
+    // Handshakes that resumed a session, and ones that did not (including sessions offered but turned down)
+    struct resumption_stats
+    {
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
+    /** Client-side TLS session cache, keyed by host:port and bounded to `capacity` sessions; the least recently used is
+        evicted first. A session stays cached, and is offered on every connect, until it expires or the server hands
+        out a newer one. Used from the endpoint's loop; `stats()` may be read from any thread.
+     */
+    class tls_session_cache
+    {
+        friend struct ctx_callbacks;
+
+      public:
+        explicit tls_session_cache(size_t capacity) : _capacity{capacity} {}
+
+        // Binds `ssl` to `key`, so that sessions it receives are cached under it, and sets the session cached for `key`
+        // (if any, and still resumable) to be offered in its handshake. Returns whether one was
+        bool resume(SSL* ssl, std::string key);
+
+        // Counts the completed handshake of `ssl` as a hit or miss
+        void record(const SSL* ssl);
+
+        void set_capacity(size_t n);
+
+        size_t capacity() const { return _capacity; }
+        size_t size() const { return _index.size(); }
+
+        resumption_stats stats() const
+        {
+            return {_hits.load(std::memory_order_relaxed), _misses.load(std::memory_order_relaxed)};
+        }
+
+      private:
+        size_t _capacity;
+
+        // most recently used first
+        std::list<std::pair<std::string, ssl_session_ptr>> _lru;
+        std::unordered_map<std::string_view, decltype(_lru)::iterator> _index;
+
+        std::atomic<uint64_t> _hits{0};
+        std::atomic<uint64_t> _misses{0};
+
+        // Takes over `sess`, received on `ssl`, for the key `ssl` was bound to; false if it was not bound
+        bool store(SSL* ssl, SSL_SESSION* sess);
+
+        void erase(decltype(_lru)::iterator it);
+
+        static int key_index();
+    };
+
     class app_context;
     using ctx_pair = std::pair<std::shared_ptr<app_context>, std::shared_ptr<app_context>>;
 
@@ -53,12 +178,26 @@ namespace wshttp
         SSL_CTX* O() { return _o.get(); }
         const SSL_CTX* O() const { return _o.get(); }
 
+        tls_session_cache& client_sessions() { return _client_sessions; }
+        const tls_session_cache& client_sessions() const { return _client_sessions; }
+
+        const std::shared_ptr<ticket_keys>& inbound_ticket_keys() const { return _ticket_keys; }
+
+        /** Has inbound sessions use `keys` for their tickets and keep up to `server_sessions` sessions server-side (see
+            `tls_resumption`). Set before any inbound handshakes; sessions accepted meanwhile may fail to resume.
+         */
+        void configure_server_resumption(std::shared_ptr<ticket_keys> keys, size_t server_sessions);
+
       private:
         std::shared_ptr<ssl_creds> _creds;
 
         ssl_ctx_ptr _i;
         ssl_ctx_ptr _o;
 
+        tls_session_cache _client_sessions{tls_resumption{}.client_sessions};
+
+        std::shared_ptr<ticket_keys> _ticket_keys;
+
         void _init();
 
         void _init_inbound();
@@ -66,6 +205,12 @@ namespace wshttp
 
         void _init_outbound();
         void _init_outbound(const char* _keyfile, const char* _certfile);
+
+        // Has the outbound context hand the sessions it receives to `_client_sessions`
+        void _init_client_resumption();
+
+        // Has the inbound context encrypt its tickets with `_ticket_keys`
+        void _init_server_resumption();
     };
 }  //  namespace wshttp
 
@@ -0,0 +1,436 @@
+#pragma once
+
+#include "timer.hpp"
+
+#include <array>
+#include <cassert>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace wshttp
+{
+    class event_loop;
+
+    template <typename T = void>
+    class task;
+
+    /** Per-loop cache of coroutine frames. Frames allocated on a loop thread are carved out in 64B size classes (up to
+        1KiB) and, when freed on that same thread, are kept for reuse instead of being handed back to the heap, so a loop
+        running thousands of short-lived request flows settles into zero allocations. Frames allocated off the loop, or
+        too large to pool, come straight from the heap; a pooled frame freed on another thread simply goes back to the
+        heap as well.
+     */
+    class frame_pool
+    {
+        friend class event_loop;
+
+        static constexpr size_t GRANULE{64};
+        static constexpr size_t NUM_CLASSES{16};
+        static constexpr size_t MAX_CACHED{256};
+
+        struct alignas(std::max_align_t) header
+        {
+            frame_pool* owner;
+        };
+
+        static thread_local frame_pool* _current;
+
+        std::array<std::vector<void*>, NUM_CLASSES> _free;
+
+        // Routes frame allocations on the calling thread through this pool; invoked on the loop thread
+        void bind() { _current = this; }
+        void unbind() { _current = nullptr; }
+
+      public:
+        frame_pool() = default;
+        frame_pool(const frame_pool&) = delete;
+        frame_pool& operator=(const frame_pool&) = delete;
+
+        ~frame_pool();
+
+        static void* allocate(size_t n);
+
+        static void deallocate(void* p, size_t n) noexcept;
+    };
+
+    namespace detail
+    {
+        // Logs the exception that escaped a detached task
+        void report_detached(std::exception_ptr err) noexcept;
+
+        // Resumes `h` from a fresh job on `loop`, rather than from within the current call stack
+        void resume_soon(event_loop& loop, std::coroutine_handle<> h);
+
+        using pending_resume = std::shared_ptr<std::coroutine_handle<>>;
+
+        // As `resume_soon`, but the resumption is called off if the returned handle is cleared before the job runs
+        pending_resume resume_cancellable(event_loop& loop, std::coroutine_handle<> h);
+
+        struct promise_base
+        {
+            std::coroutine_handle<> _continuation;
+            std::exception_ptr _err;
+            bool _detached{false};
+
+            static void* operator new(size_t n) { return frame_pool::allocate(n); }
+            static void operator delete(void* p, size_t n) noexcept { frame_pool::deallocate(p, n); }
+
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+                {
+                    auto& p = h.promise();
+
+                    if (p._continuation)
+                        return p._continuation;
+
+                    if (p._detached)
+                    {
+                        if (p._err)
+                            report_detached(p._err);
+                        h.destroy();
+                    }
+
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            final_awaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() noexcept { _err = std::current_exception(); }
+        };
+
+        template <typename T>
+        struct promise : promise_base
+        {
+            std::optional<T> _val;
+
+            task<T> get_return_object();
+
+            template <typename U>
+            void return_value(U&& v)
+            {
+                _val.emplace(std::forward<U>(v));
+            }
+
+            T result()
+            {
+                if (_err)
+                    std::rethrow_exception(_err);
+                return std::move(*_val);
+            }
+        };
+
+        template <>
+        struct promise<void> : promise_base
+        {
+            task<void> get_return_object();
+
+            void return_void() {}
+
+            void result()
+            {
+                if (_err)
+                    std::rethrow_exception(_err);
+            }
+        };
+    }  //  namespace detail
+
+    /** Lazily started coroutine returning `T`. A task does not run until it is either awaited by another coroutine,
+        which resumes once the task completes (without going back through the event loop), or handed to the loop with
+        `event_loop::spawn` / `event_loop::block_on`. Exceptions propagate to the awaiter.
+     */
+    template <typename T>
+    class [[nodiscard]] task
+    {
+        friend class event_loop;
+
+      public:
+        using promise_type = detail::promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        task() = default;
+
+        task(task&& other) noexcept : _h{std::exchange(other._h, {})} {}
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_h)
+                    _h.destroy();
+                _h = std::exchange(other._h, {});
+            }
+            return *this;
+        }
+
+        ~task()
+        {
+            if (_h)
+                _h.destroy();
+        }
+
+        struct awaiter
+        {
+            handle_type h;
+
+            bool await_ready() const
+            {
+                if (not h)
+                    throw std::invalid_argument{"Cannot await an empty task"};
+                return h.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept
+            {
+                h.promise()._continuation = c;
+                return h;
+            }
+
+            T await_resume() { return h.promise().result(); }
+        };
+
+        awaiter operator co_await() && noexcept { return awaiter{_h}; }
+
+        explicit operator bool() const { return bool{_h}; }
+
+      private:
+        handle_type _h;
+
+        explicit task(handle_type h) : _h{h} {}
+
+        handle_type release() { return std::exchange(_h, {}); }
+
+        friend struct detail::promise<T>;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        task<T> promise<T>::get_return_object()
+        {
+            return task<T>{std::coroutine_handle<promise<T>>::from_promise(*this)};
+        }
+
+        inline task<void> promise<void>::get_return_object()
+        {
+            return task<void>{std::coroutine_handle<promise<void>>::from_promise(*this)};
+        }
+    }  //  namespace detail
+
+    /** Awaitable returned by `event_loop::sleep`; suspends the coroutine on the loop's timer wheel. It lives in the
+        suspended frame, so destroying the frame before the timer fires cancels the timer along with it.
+     */
+    struct sleep_awaiter
+    {
+        event_loop& _loop;
+        std::chrono::microseconds _delay;
+        timer_res _res;
+        timer_handle _timer{};
+
+        ~sleep_awaiter() { _timer.cancel(); }
+
+        bool await_ready() const noexcept { return _delay <= 0us; }
+
+        void await_suspend(std::coroutine_handle<> h);
+
+        void await_resume() const noexcept {}
+    };
+
+    /** Awaitable returned by `event_loop::resume_on`; continues the coroutine on the loop thread */
+    struct resume_on_awaiter
+    {
+        event_loop& _loop;
+
+        bool await_ready() const noexcept;
+
+        void await_suspend(std::coroutine_handle<> h);
+
+        void await_resume() const noexcept {}
+    };
+
+    /** Single-consumer queue of values produced on the event loop thread, awaited with `co_await ch.next()`. Awaiting
+        yields the next value, or std::nullopt once the channel is closed (or destroyed) and drained. Waiters are always
+        resumed from a fresh loop job, never from inside `push`/`close`, so producers may safely sit in the middle of a
+        libevent or nghttp2 callback. Loop thread only.
+     */
+    template <typename T>
+    class async_channel
+    {
+      public:
+        struct awaiter
+        {
+            async_channel* _ch;
+            std::optional<T> _value{};
+            std::coroutine_handle<> _h{};
+            detail::pending_resume _wake{};
+
+            // a coroutine destroyed while suspended here must neither be handed a value nor resumed
+            ~awaiter()
+            {
+                if (_wake)
+                    *_wake = nullptr;
+                else if (_h and _ch->_waiter == this)
+                    _ch->_waiter = nullptr;
+            }
+
+            bool await_ready()
+            {
+                if (not _ch->_items.empty())
+                {
+                    _value.emplace(std::move(_ch->_items.front()));
+                    _ch->_items.pop_front();
+                    return true;
+                }
+                return _ch->_closed;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                assert(not _ch->_waiter);
+                _h = h;
+                _ch->_waiter = this;
+            }
+
+            std::optional<T> await_resume() { return std::move(_value); }
+        };
+
+        explicit async_channel(event_loop& l) : _loop{l} {}
+
+        async_channel(const async_channel&) = delete;
+        async_channel& operator=(const async_channel&) = delete;
+
+        ~async_channel() { close(); }
+
+        void push(T v)
+        {
+            if (_closed)
+                return;
+
+            if (auto* w = std::exchange(_waiter, nullptr))
+            {
+                w->_value.emplace(std::move(v));
+                w->_wake = detail::resume_cancellable(_loop, w->_h);
+            }
+            else
+                _items.push_back(std::move(v));
+        }
+
+        void close()
+        {
+            if (std::exchange(_closed, true))
+                return;
+
+            if (auto* w = std::exchange(_waiter, nullptr))
+                w->_wake = detail::resume_cancellable(_loop, w->_h);
+        }
+
+        bool closed() const { return _closed; }
+
+        awaiter next() { return awaiter{this}; }
+
+      private:
+        event_loop& _loop;
+        std::deque<T> _items;
+        awaiter* _waiter{nullptr};
+        bool _closed{false};
+    };
+
+    /** One-shot value awaited by any number of coroutines with `co_await l.wait()`. Waiters suspended before `set`
+        receive the value when it is set; later waiters receive it immediately. If the latch is destroyed before being
+        set, suspended waiters receive `T{}`. As with async_channel, waiters are resumed from a fresh loop job. Loop thread
+        only.
+     */
+    template <typename T>
+    class async_latch
+    {
+      public:
+        struct awaiter
+        {
+            async_latch* _l;
+            T _value{};
+            std::coroutine_handle<> _h{};
+            detail::pending_resume _wake{};
+
+            // as with async_channel, a waiter destroyed while suspended drops out of the latch
+            ~awaiter()
+            {
+                if (_wake)
+                    *_wake = nullptr;
+                else if (_h)
+                    std::erase(_l->_waiters, this);
+            }
+
+            bool await_ready()
+            {
+                if (not _l)
+                    return true;
+
+                if (_l->_value)
+                {
+                    _value = *_l->_value;
+                    return true;
+                }
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                _h = h;
+                _l->_waiters.push_back(this);
+            }
+
+            T await_resume() { return std::move(_value); }
+        };
+
+        explicit async_latch(event_loop& l) : _loop{l} {}
+
+        async_latch(const async_latch&) = delete;
+        async_latch& operator=(const async_latch&) = delete;
+
+        ~async_latch() { _release(T{}); }
+
+        void set(T v)
+        {
+            if (_value)
+                return;
+
+            _value.emplace(v);
+            _release(std::move(v));
+        }
+
+        bool is_set() const { return _value.has_value(); }
+
+        awaiter wait() { return awaiter{this}; }
+
+        // Awaiter that is immediately ready with `v`, for when there is no latch to wait on
+        static awaiter ready(T v) { return awaiter{nullptr, std::move(v)}; }
+
+      private:
+        event_loop& _loop;
+        std::optional<T> _value;
+        std::vector<awaiter*> _waiters;
+
+        void _release(const T& v)
+        {
+            for (auto* w : std::exchange(_waiters, {}))
+            {
+                w->_value = v;
+                w->_wake = detail::resume_cancellable(_loop, w->_h);
+            }
+        }
+    };
+}  //  namespace wshttp
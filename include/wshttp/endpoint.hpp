@@ -5,18 +5,98 @@
 #include "listener.hpp"
 #include "loop.hpp"
 #include "node.hpp"
+#include "request.hpp"
 
 namespace wshttp
 {
     using namespace wshttp::literals;
 
     struct ssl_creds;
+    class stream;
 
     namespace dns
     {
         class server;
     }
 
+    /** Output buffering of the endpoint's sessions; pass as an endpoint option to override the defaults.
+
+        A session pulls frames from nghttp2 into its output buffer until it holds `high` bytes, then waits for the
+        socket to drain it down to `low` before pulling more. With `adaptive`, each session instead sizes its high mark
+        from the throughput and RTT it observes (twice the bandwidth-delay product, between `high` and `max`), so that
+        sessions on high-BDP links are not throttled by a fixed amount of buffered output; `low` scales along with it.
+     */
+    struct write_watermarks
+    {
+        size_t low{1 << 14};
+        size_t high{1 << 16};
+        bool adaptive{false};
+        size_t max{1 << 24};
+    };
+
+    /** HTTP/2 SETTINGS a session advertises once connected, and the size of its connection-level receive window. Unset
+        values stay at the RFC 9113 defaults: 64KiB windows, 16KiB frames, a 4KiB header table and no header list limit.
+
+        A session receives at most one window per round trip, so bulk transfers over long links need larger windows
+        than the defaults allow; see `bulk()`.
+     */
+    struct h2_settings
+    {
+        uint32_t max_concurrent_streams{100};
+        std::optional<uint32_t> initial_window_size;
+        std::optional<uint32_t> connection_window_size;
+        std::optional<uint32_t> max_frame_size;
+        std::optional<uint32_t> header_table_size;
+        std::optional<uint32_t> max_header_list_size;
+
+        // 16MiB stream and 64MiB connection windows with 64KiB frames: over 1Gbps per stream at 100ms RTT
+        static h2_settings bulk()
+        {
+            h2_settings s;
+            s.initial_window_size = 1 << 24;
+            s.connection_window_size = 1 << 26;
+            s.max_frame_size = 1 << 16;
+            return s;
+        }
+
+        // SETTINGS frame entries; the connection window is not a setting, and is sent as a WINDOW_UPDATE instead
+        std::vector<nghttp2_settings_entry> entries() const
+        {
+            std::vector<nghttp2_settings_entry> e{{NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, max_concurrent_streams}};
+
+            if (initial_window_size)
+                e.push_back({NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, *initial_window_size});
+            if (max_frame_size)
+                e.push_back({NGHTTP2_SETTINGS_MAX_FRAME_SIZE, *max_frame_size});
+            if (header_table_size)
+                e.push_back({NGHTTP2_SETTINGS_HEADER_TABLE_SIZE, *header_table_size});
+            if (max_header_list_size)
+                e.push_back({NGHTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, *max_header_list_size});
+
+            return e;
+        }
+    };
+
+    // HTTP/2 settings for the endpoint's inbound (accepted) and outbound (connected) sessions, as an endpoint option
+    struct h2_profile
+    {
+        h2_settings inbound{};
+        h2_settings outbound{};
+    };
+
+    /** Where the endpoint's sessions do TLS record crypto; pass as an endpoint option to opt into kernel TLS.
+
+        With `tls_mode::kernel`, OpenSSL hands the session keys to the kernel once the handshake completes, so records
+        are encrypted (and, where supported, decrypted) in-kernel and file bodies are sent with sendfile. Sessions fall
+        back to userspace TLS whenever the kernel or the negotiated cipher does not support it; see
+        `session_base::ktls_send()`/`ktls_recv()` for which path a session ended up on.
+     */
+    enum class tls_mode
+    {
+        userspace,
+        kernel
+    };
+
     class endpoint final
     {
         friend class inbound_session;
@@ -37,20 +117,32 @@ namespace wshttp
             require_ssl_creds<Opt...>();
 
             if constexpr (sizeof...(opts))
-                handle_ep_opt(std::forward<Opt>(opts)...);
+                (handle_ep_opt(std::forward<Opt>(opts)), ...);
 
             // _dns->initialize();
             log->trace("Client endpoint created with initialized event loop!");
         }
 
+        template <typename... Opt>
+        explicit endpoint(std::shared_ptr<event_loop_pool> pool, Opt&&... opts)
+            : endpoint{pool->primary(), std::forward<Opt>(opts)...}
+        {
+            _pool = std::move(pool);
+            log->trace("Client endpoint sharding listeners across {} event loops", _pool->size());
+        }
+
       public:
         endpoint& operator=(endpoint) = delete;
         endpoint& operator=(endpoint&&) = delete;
 
+        // A `loop_mode` option picks the locking of the loop made here (single-threaded falls back to threadsafe in
+        // builds without lock-free loops; see `event_loop::supports_lock_free`); given a loop or pool, it has to match
+        // theirs
         template <typename... Opt>
         [[nodiscard]] static std::shared_ptr<endpoint> make(Opt&&... args)
         {
-            return endpoint::make(event_loop::make(), std::forward<Opt>(args)...);
+            return endpoint::make(
+                event_loop::make(std::nullopt, std::nullopt, requested_mode(args...)), std::forward<Opt>(args)...);
         }
 
         template <typename... Opt>
@@ -59,20 +151,41 @@ namespace wshttp
             return ev_loop->template make_shared<endpoint>(std::move(ev_loop), std::forward<Opt>(args)...);
         }
 
+        template <typename... Opt>
+        [[nodiscard]] static std::shared_ptr<endpoint> make(std::shared_ptr<event_loop_pool> pool, Opt&&... args)
+        {
+            auto& primary = pool->primary();
+            return primary->template make_shared<endpoint>(std::move(pool), std::forward<Opt>(args)...);
+        }
+
         ~endpoint();
 
       private:
         std::shared_ptr<event_loop> _loop;
 
+        // set when made on an event_loop_pool, of which `_loop` is the primary
+        std::shared_ptr<event_loop_pool> _pool;
+
         std::shared_ptr<dns::server> _dns;
 
         std::shared_ptr<app_context> _ctx;
 
+        write_watermarks _watermarks{};
+
+        tls_mode _tls_mode{tls_mode::userspace};
+
+        tls_resumption _resumption{};
+
+        // drives rotation of the inbound ticket keys once the endpoint listens
+        std::shared_ptr<ev_watcher> _ticket_rotation;
+
+        h2_profile _h2{};
+
         const caller_id_t client_id;
         static caller_id_t next_client_id;
 
-        // local listeners managing inbound https connections
-        std::unordered_map<uint16_t, std::shared_ptr<listener>> _listeners;
+        // local listeners managing inbound https connections; one per loop when sharded across a pool
+        std::unordered_map<uint16_t, std::vector<std::shared_ptr<listener>>> _listeners;
 
         // local nodes managing outbound https connections
         std::unordered_map<std::string, std::shared_ptr<node>> _nodes;
@@ -80,23 +193,10 @@ namespace wshttp
         std::atomic<bool> _close_immediately{false};
 
       public:
-        bool listen(uint16_t port)
-        {
-            return call_get([&]() {
-                auto [itr, b] = _listeners.try_emplace(port, nullptr);
-
-                if (not b)
-                    throw std::invalid_argument{
-                        "Cannot create tcp-listener at port {} -- listener already exists!"_format(port)};
-
-                itr->second = make_shared<listener>(*this, port);
-
-                if (not itr->second)
-                    throw std::runtime_error{"TCP listener construction failed!"};
-
-                return true;
-            });
-        }
+        /** Listens for inbound connections on `port`. On an endpoint made from an event_loop_pool, every loop in the pool
+            gets its own SO_REUSEPORT listener on that port, so the kernel spreads accepted connections across the loops.
+         */
+        bool listen(uint16_t port);
 
         template <typename... Opt>
         bool connect(std::string_view url, Opt&&... opts)
@@ -121,6 +221,23 @@ namespace wshttp
             });
         }
 
+        /** Resolves to true once an outbound session to `host` (see `connect`) has connected and negotiated h2, or to
+            false if it failed, was closed first, or the host has no node. Opens a session if the node's pool has none
+            left, e.g. after reaping idle ones. Must be awaited on the loop thread, e.g. after
+            `co_await loop.resume_on()`.
+         */
+        async_latch<bool>::awaiter connected(std::string_view host);
+
+        /** Submits `req` to `host` (see `connect`) on the node's least loaded session, which holds it until connected
+            if need be; see `node::acquire_session`. The response is delivered through `handler` and the returned
+            stream, which the caller may drop if it only uses the handler. Returns nullptr if `host` has no node or the
+            request could not be submitted. May be invoked from any thread; the handler runs on the loop thread.
+         */
+        std::shared_ptr<stream> submit(std::string_view host, request req, response_handler handler = {});
+
+        // Outbound handshakes that resumed a cached TLS session, and ones that did not; see `tls_resumption`
+        resumption_stats outbound_resumption() const { return _ctx->client_sessions().stats(); }
+
         void test_parse_method(std::string url);
 
         template <typename Callable>
@@ -135,18 +252,23 @@ namespace wshttp
             return _loop->call_get(std::forward<Callable>(f));
         }
 
-        void call_soon(std::function<void(void)> f) { _loop->call_soon(std::move(f)); }
+        template <std::invocable Callable>
+        void call_soon(Callable&& f)
+        {
+            _loop->call_soon(std::forward<Callable>(f));
+        }
 
         template <typename Callable>
-        [[nodiscard]] std::shared_ptr<ev_watcher> call_every(std::chrono::microseconds interval, Callable&& f)
+        [[nodiscard]] std::shared_ptr<ev_watcher> call_every(
+            std::chrono::microseconds interval, Callable&& f, timer_res res = timer_res::fine)
         {
-            return _loop->_call_every(interval, std::forward<Callable>(f), client_id);
+            return _loop->_call_every(interval, std::forward<Callable>(f), client_id, true, false, res);
         }
 
         template <typename Callable>
-        void call_later(std::chrono::microseconds delay, Callable&& hook)
+        timer_handle call_later(std::chrono::microseconds delay, Callable&& hook, timer_res res = timer_res::fine)
         {
-            _loop->call_later(delay, std::forward<Callable>(hook));
+            return _loop->call_later(delay, std::forward<Callable>(hook), res);
         }
 
         void set_shutdown_immediate(bool b = true) { _close_immediately = b; }
@@ -166,6 +288,9 @@ namespace wshttp
 
         void close_listener(uint16_t p);
 
+        // Destroys each listener on its own loop, along with every session it accepted
+        static void drop_listeners(std::vector<std::shared_ptr<listener>>& ls);
+
         bool in_event_loop() const { return _loop->in_event_loop(); }
 
         void shutdown_endpoint();
@@ -177,6 +302,37 @@ namespace wshttp
       private:
         void handle_ep_opt(std::shared_ptr<ssl_creds> c);
 
+        void handle_ep_opt(write_watermarks w);
+
+        void handle_ep_opt(tls_mode m);
+
+        void handle_ep_opt(tls_resumption r);
+
+        // Applies `_resumption` to the context, making ticket keys if none were given
+        void apply_resumption();
+
+        void handle_ep_opt(h2_profile p);
+
+        void handle_ep_opt(loop_mode m);
+
+        template <typename... Opt>
+        static loop_mode requested_mode(const Opt&... opts)
+        {
+            auto mode = loop_mode::threadsafe;
+
+            (
+                [&](const auto& o) {
+                    if constexpr (std::is_same_v<std::remove_cvref_t<decltype(o)>, loop_mode>)
+                        mode = o;
+                }(opts),
+                ...);
+
+            return mode;
+        }
+
+        // Applies per-session TLS settings common to inbound and outbound sessions
+        void configure_ssl(SSL* ssl) const;
+
         template <typename... Opt>
         static constexpr void require_ssl_creds()
         {
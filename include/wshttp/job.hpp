@@ -0,0 +1,107 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wshttp
+{
+    inline constexpr size_t JOB_INLINE_SIZE{64};
+
+    /** Move-only `void()` callable with a fixed inline buffer, used for everything posted to or scheduled on the event
+        loop. Unlike std::function it never allocates: a callable that does not fit in `N` bytes (or needs stricter than
+        max_align_t alignment) is rejected at compile time. Capture less, or hold larger state behind a pointer.
+     */
+    template <size_t N = JOB_INLINE_SIZE>
+    class inline_job
+    {
+        struct vtable
+        {
+            void (*invoke)(void*);
+            void (*relocate)(void* dest, void* src) noexcept;
+            void (*destroy)(void*) noexcept;
+        };
+
+        template <typename F>
+        static constexpr vtable vtable_for{
+            .invoke = [](void* f) { (*static_cast<F*>(f))(); },
+            .relocate =
+                [](void* dest, void* src) noexcept {
+                    new (dest) F(std::move(*static_cast<F*>(src)));
+                    static_cast<F*>(src)->~F();
+                },
+            .destroy = [](void* f) noexcept { static_cast<F*>(f)->~F(); }};
+
+        alignas(std::max_align_t) std::byte _buf[N];
+        const vtable* _vt{nullptr};
+
+      public:
+        static constexpr size_t capacity = N;
+
+        inline_job() = default;
+        inline_job(std::nullptr_t) {}
+
+        template <typename Callable>
+            requires(!std::same_as<std::remove_cvref_t<Callable>, inline_job> && std::invocable<std::decay_t<Callable>&>)
+        inline_job(Callable&& f)
+        {
+            using F = std::decay_t<Callable>;
+
+            static_assert(sizeof(F) <= N, "Callable captures too much state to be stored inline in a wshttp job");
+            static_assert(alignof(F) <= alignof(std::max_align_t), "Callable is over-aligned for a wshttp job");
+            static_assert(std::is_nothrow_move_constructible_v<F>, "Callable must be nothrow move constructible");
+
+            new (_buf) F(std::forward<Callable>(f));
+            _vt = &vtable_for<F>;
+        }
+
+        inline_job(const inline_job&) = delete;
+        inline_job& operator=(const inline_job&) = delete;
+
+        inline_job(inline_job&& other) noexcept { _take(other); }
+
+        inline_job& operator=(inline_job&& other) noexcept
+        {
+            if (this != &other)
+            {
+                _reset();
+                _take(other);
+            }
+            return *this;
+        }
+
+        inline_job& operator=(std::nullptr_t) noexcept
+        {
+            _reset();
+            return *this;
+        }
+
+        ~inline_job() { _reset(); }
+
+        void operator()() { _vt->invoke(_buf); }
+
+        explicit operator bool() const { return _vt != nullptr; }
+
+      private:
+        void _take(inline_job& other) noexcept
+        {
+            if (other._vt)
+            {
+                other._vt->relocate(_buf, other._buf);
+                _vt = std::exchange(other._vt, nullptr);
+            }
+        }
+
+        void _reset() noexcept
+        {
+            if (_vt)
+                std::exchange(_vt, nullptr)->destroy(_buf);
+        }
+    };
+
+    using Job = inline_job<>;
+}  //  namespace wshttp
@@ -2,13 +2,18 @@
 
 #include "address.hpp"
 #include "context.hpp"
+#include "timer.hpp"
 
 namespace wshttp
 {
     class app_context;
     class endpoint;
+    class event_loop;
     class inbound_session;
 
+    // Delay before re-arming an io_uring accept the kernel ended on a resource limit (EMFILE, ENFILE, ENOMEM)
+    inline constexpr std::chrono::milliseconds ACCEPT_RETRY_DELAY{100ms};
+
     class listener
     {
         friend class inbound_session;
@@ -16,7 +21,11 @@ namespace wshttp
         friend class event_loop;
         friend struct listen_callbacks;
 
-        explicit listener(endpoint& e, uint16_t p) : _ep{e}, _local{p} { _init_internals(); }
+        explicit listener(endpoint& e, event_loop& l, uint16_t p, bool reuse_port = false)
+            : _ep{e}, _loop{l}, _local{p}, _reuse_port{reuse_port}
+        {
+            _init_internals();
+        }
 
       public:
         listener() = delete;
@@ -25,9 +34,19 @@ namespace wshttp
 
       private:
         endpoint& _ep;
+        event_loop& _loop;
         ip_address _local{};
         int _fd{-1};
 
+        // set when one of several listeners sharing this port across an event_loop_pool
+        bool _reuse_port{false};
+
+        // multishot accept in flight on the loop's io_ring, when accepting through io_uring rather than libevent
+        uint64_t _accept_op{0};
+
+        // pending re-arm of `_accept_op` after the kernel ran out of descriptors or memory
+        timer_handle _accept_retry;
+
         tcp_listener _tcp;
 
         // key: remote address, value: session ptr
@@ -35,6 +54,12 @@ namespace wshttp
 
         void _init_internals();
 
+        void _listen_evconn(const sockaddr_in& addr);
+
+        void _listen_uring(const sockaddr_in& addr);
+
+        void _arm_accept();
+
       protected:
         SSL* new_ssl();
 
@@ -1,44 +1,268 @@
 #pragma once
 
+#include "coro.hpp"
+#include "job.hpp"
+#include "queue.hpp"
+#include "stats.hpp"
+#include "timer.hpp"
 #include "types.hpp"
 
 #include <atomic>
 #include <cstdint>
+#include <exception>
 #include <future>
-#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 #include <memory>
 #include <thread>
 
 namespace wshttp
 {
-    using Job = std::function<void()>;
-    using loop_ptr = std::shared_ptr<::event_base>;
     using caller_id_t = uint16_t;
 
+    /** Scheduling class of a job posted to the event loop. Latency-critical jobs (the default) run first on each
+        wakeup; background jobs, such as the deferred destruction behind `loop_deleter`, only get what is left of the
+        iteration's budget, plus a small guaranteed share so they cannot be starved outright. A background job never
+        overtakes latency-critical ones posted before it, which may still hold references to what it destroys.
+     */
+    enum class job_prio : uint8_t
+    {
+        latency,
+        background,
+    };
+
+    // Upper bounds on the work a single wakeup of the job queue may do before handing control back to socket I/O
+    inline constexpr size_t DEFAULT_JOB_BUDGET_COUNT{256};
+    inline constexpr std::chrono::microseconds DEFAULT_JOB_BUDGET_TIME{500us};
+
+    // Background jobs run per wakeup even when latency-critical work used up the whole budget
+    inline constexpr size_t BACKGROUND_JOB_MIN{8};
+
+    /** Busy-poll mode, for latency-sensitive deployments willing to burn a core per loop. Instead of going straight to
+        sleep in epoll once idle, the loop thread keeps polling its sockets (non-blocking) and the job queue for up to
+        the current spin window; producers posting jobs meanwhile skip the eventfd write altogether.
+
+        The spin window adapts between `min_spin` and `max_spin`: it doubles whenever the loop had to block but was
+        woken again within `max_spin` (spinning longer would have caught that), and halves whenever it spins out
+        without finding any work.
+     */
+    struct busy_poll_config
+    {
+        std::chrono::microseconds min_spin{5us};
+        std::chrono::microseconds max_spin{200us};
+    };
+
+    /** Locking of a loop's libevent structures; also accepted as an endpoint option (see `endpoint::make`).
+
+        Everything touching a loop's event base, bufferevents and listeners already runs on the loop thread, and other
+        threads only reach it through the job queue. With `loop_mode::single_threaded`, the base is created with
+        `EVENT_BASE_FLAG_NOLOCK` and sessions and listeners on it without their threadsafe flags, saving a lock/unlock
+        around every libevent call. It requires the eventfd job waker, which wakes the loop without touching the base.
+     */
+    enum class loop_mode
+    {
+        threadsafe,
+        single_threaded
+    };
+
     class event_loop;
+    class io_ring;
+    class ring_socket;
+    class session_base;
+    struct ev_watcher;
 
-    struct ev_watcher
+    namespace detail
+    {
+        // Only one job in this many (per posting thread) is timed for the `job_wait` and `job_run` histograms; reading
+        // the clock around every job would cost about as much as running a small one
+        inline constexpr uint32_t JOB_SAMPLE_INTERVAL{16};
+
+        inline bool sample_job()
+        {
+            thread_local uint32_t n{0};
+            return n++ % JOB_SAMPLE_INTERVAL == 0;
+        }
+
+        // Entry of the job queues; sampled jobs carry their enqueue time, the others a zero time_point
+        struct queued_job
+        {
+            Job job;
+            std::chrono::steady_clock::time_point posted{};
+
+            // background jobs only: number of latency-critical jobs posted before this one, which run first
+            uint64_t after{0};
+
+            template <typename Callable>
+                requires(not std::same_as<std::remove_cvref_t<Callable>, queued_job>)
+            explicit queued_job(Callable&& f) : job{std::forward<Callable>(f)}
+            {
+                if (sample_job())
+                    posted = get_time();
+            }
+        };
+
+        /** Completion slot for a blocking cross-thread `call_get`. It lives on the calling thread's stack, so a
+            round trip allocates nothing beyond the job itself: the loop thread stores the result (or the exception) and
+            flips `_state`, which the caller blocks on with std::atomic::wait (a futex on linux).
+
+            The caller is woken as soon as the result is `READY`, but the loop thread is still inside `notify_one` on
+            the slot at that point. It acknowledges with `DONE` once it is through, and the caller waits for that before
+            returning and tearing the slot down; the window is a single futex wake, so it just spins.
+         */
+        template <typename Ret>
+        class call_slot
+        {
+            struct empty
+            {};
+
+            enum : uint32_t
+            {
+                EMPTY,
+                READY,
+                DONE
+            };
+
+            std::atomic<uint32_t> _state{EMPTY};
+            std::exception_ptr _err;
+            [[no_unique_address]] std::conditional_t<std::is_void_v<Ret>, empty, std::optional<Ret>> _val;
+
+          public:
+            template <typename Callable>
+            void run(Callable&& f) noexcept
+            {
+                try
+                {
+                    if constexpr (std::is_void_v<Ret>)
+                        f();
+                    else
+                        _val.emplace(f());
+                }
+                catch (...)
+                {
+                    _err = std::current_exception();
+                }
+
+                _state.store(READY, std::memory_order_release);
+                _state.notify_one();
+
+                // last touch of the slot
+                _state.store(DONE, std::memory_order_release);
+            }
+
+            Ret get()
+            {
+                _state.wait(EMPTY, std::memory_order_acquire);
+
+                while (_state.load(std::memory_order_acquire) != DONE)
+                    std::this_thread::yield();
+
+                if (_err)
+                    std::rethrow_exception(_err);
+
+                if constexpr (not std::is_void_v<Ret>)
+                    return std::move(*_val);
+            }
+        };
+    }  //  namespace detail
+
+    struct ticker_id
+    {
+        uint32_t index{std::numeric_limits<uint32_t>::max()};
+        uint32_t gen{0};
+    };
+
+    /** Registry of the live tickers on an event loop, grouped by the caller that created them. Entries live in a slab
+        indexed by `ticker_id` and are threaded onto an intrusive per-caller list, so registering, unregistering and
+        walking one caller's tickers never touch anyone else's. Watchers unregister themselves on destruction, so there
+        is nothing to sweep. Loop thread only.
+     */
+    class ticker_registry
+    {
+        static constexpr uint32_t NIL{std::numeric_limits<uint32_t>::max()};
+
+        struct entry
+        {
+            ev_watcher* w{nullptr};
+            uint32_t gen{0};
+            uint32_t prev{NIL};
+            uint32_t next{NIL};
+            caller_id_t owner{0};
+        };
+
+        std::vector<entry> _slab;
+        std::vector<uint32_t> _free;
+        std::unordered_map<caller_id_t, uint32_t> _heads;
+
+      public:
+        ticker_id add(caller_id_t owner, ev_watcher* w);
+
+        // No-op for an id that was already removed or detached
+        void remove(ticker_id id);
+
+        // Detaches every ticker belonging to `owner`, handing each to `f` first
+        template <std::invocable<ev_watcher&> Callable>
+        void release(caller_id_t owner, Callable&& f)
+        {
+            auto it = _heads.find(owner);
+            if (it == _heads.end())
+                return;
+
+            for (auto idx = it->second; idx != NIL;)
+            {
+                auto* w = _slab[idx].w;
+                auto next = _slab[idx].next;
+                _reset(idx);
+                f(*w);
+                idx = next;
+            }
+
+            _heads.erase(it);
+        }
+
+        // Detaches every ticker on the loop, handing each to `f` first
+        template <std::invocable<ev_watcher&> Callable>
+        void release_all(Callable&& f)
+        {
+            while (not _heads.empty())
+                release(_heads.begin()->first, f);
+        }
+
+      private:
+        void _reset(uint32_t idx);
+    };
+
+    /** Repeating event handed out by `call_every`. Starting and stopping it never blocks: `is_running` flips right
+        away, and the loop thread arms or cancels the timer to match as soon as it gets to it.
+     */
+    struct ev_watcher : std::enable_shared_from_this<ev_watcher>
     {
         friend class event_loop;
-        friend struct loop_callbacks;
 
       private:
+        event_loop& _loop;
+        ticker_id _id{};
         std::atomic<bool> _is_running{false};
-        event_ptr ev;
-        timeval interval;
-        std::function<void()> f;
+        std::chrono::microseconds interval{};
+        timer_res res{timer_res::fine};
+        bool wait{false};
+        timer_handle _timer;  // loop thread only
+        Job f;
+
+        explicit ev_watcher(event_loop& l) : _loop{l} {}
 
         void init_event(
-            const loop_ptr& _loop,
             std::chrono::microseconds _t,
-            std::function<void()> task,
-            bool one_off = false,
+            Job task,
             bool start_immediately = true,
-            bool fixed_interval = false);
+            bool fixed_interval = false,
+            timer_res _res = timer_res::fine);
 
-        ev_watcher() = default;
+        // Arms or cancels the timer to match `_is_running`; loop thread only
+        void _sync();
 
-        void fire();
+        // Has the loop thread `_sync`, once it gets to it
+        void _request_sync();
 
       public:
         ~ev_watcher();
@@ -47,15 +271,15 @@ namespace wshttp
 
         /** Starts the repeating event on the given interval on Ticker creation
             Returns:
-                - true: event successfully started
-                - false: event is already running, or failed to start the event
+                - true: event started
+                - false: event is already running
          */
         bool start();
 
         /** Stops the repeating event managed by Ticker
             Returns:
-                - true: event successfully stopped
-                - false: event is already stopped, or failed to stop the event
+                - true: event stopped
+                - false: event is already stopped
          */
         bool stop();
     };
@@ -63,8 +287,25 @@ namespace wshttp
     class event_loop final
     {
         friend class endpoint;
-
-        event_loop();
+        friend class listener;
+        friend class session_base;
+        friend class inbound_session;
+        friend class outbound_session;
+        friend class stream;
+        friend class event_loop_pool;
+        friend class io_ring;
+        friend class ring_socket;
+        friend class timer_wheel;
+        friend class timer_handle;
+        friend struct ev_watcher;
+        friend struct callback_probe;
+        friend struct sleep_awaiter;
+        friend struct resume_on_awaiter;
+
+        explicit event_loop(
+            std::optional<uint32_t> core = std::nullopt,
+            std::optional<busy_poll_config> busy_poll = std::nullopt,
+            loop_mode mode = loop_mode::threadsafe);
 
         event_loop(const event_loop&) = delete;
         event_loop(event_loop&&) = delete;
@@ -72,7 +313,15 @@ namespace wshttp
         event_loop& operator=(event_loop) = delete;
 
       public:
-        [[nodiscard]] static std::shared_ptr<event_loop> make();
+        /** Starts a new event loop on its own thread; if `core` is given, the thread is pinned to that cpu where the
+            platform supports it (linux), and runs unpinned otherwise. With `busy_poll`, the loop spins before blocking
+            (see `busy_poll_config`); it is meant to be pinned, and a warning is logged otherwise. `mode` picks whether
+            its libevent structures are locked (see `loop_mode`).
+         */
+        [[nodiscard]] static std::shared_ptr<event_loop> make(
+            std::optional<uint32_t> core = std::nullopt,
+            std::optional<busy_poll_config> busy_poll = std::nullopt,
+            loop_mode mode = loop_mode::threadsafe);
 
         ~event_loop();
 
@@ -83,16 +332,67 @@ namespace wshttp
         std::thread::id loop_thread_id;
 
         event_ptr job_waker;
-        std::queue<Job> job_queue;
-        std::mutex job_queue_mutex;
+        int job_wake_fd{-1};
+        mpsc_queue<detail::queued_job> job_queue;
+        mpsc_queue<detail::queued_job> bg_job_queue;
+
+        // Latency-critical jobs posted so far, and run so far (loop thread only); background jobs are stamped with the
+        // former when posted, and held back until the latter catches up (see `queued_job::after`)
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> jobs_posted{0};
+        uint64_t jobs_run{0};
+
+        size_t job_budget_count{DEFAULT_JOB_BUDGET_COUNT};
+        std::chrono::microseconds job_budget_time{DEFAULT_JOB_BUDGET_TIME};
 
-        std::unordered_map<caller_id_t, std::list<std::weak_ptr<ev_watcher>>> tickers;
+        // Set by the first producer to signal the waker, cleared by the loop thread when it begins draining; every
+        // other `call_soon` in between skips the wakeup entirely
+        std::atomic<bool> wake_pending{false};
+
+        std::shared_ptr<timer_wheel> fine_timers;
+        std::shared_ptr<timer_wheel> coarse_timers;
+
+        ticker_registry tickers;
+
+        frame_pool frames;
+
+        // only set when built with WSHTTP_USE_IO_URING, and io_uring is usable at runtime
+        std::unique_ptr<io_ring> uring;
+
+        loop_histograms metrics;
+
+        // Sessions with frames queued in nghttp2 during the current iteration, written out together once its callbacks
+        // have run (see `session_base::schedule_send`); `flushing` is the batch being written
+        event_ptr flush_ev;
+        std::vector<session_base*> dirty_sessions;
+        std::vector<session_base*> flushing;
+
+        // time the first callback of the current loop iteration started; reset once the iteration is over
+        std::chrono::steady_clock::time_point busy_since{};
+
+        std::atomic<bool> stopping{false};
+
+        std::optional<busy_poll_config> poll_config;
+
+        loop_mode _mode;
+        std::chrono::nanoseconds spin_window{0};
 
       public:
         const std::shared_ptr<::event_base>& loop() const { return ev_loop; }
 
+        /** Snapshot of the loop's latency and saturation histograms (see `loop_stats`); lock-free, callable from any
+            thread */
+        loop_stats stats() const { return metrics.snapshot(); }
+
+        loop_mode mode() const { return _mode; }
+
+        // whether libevent structures on this loop are created without locks (see `loop_mode`)
+        bool lock_free() const { return _mode == loop_mode::single_threaded; }
+
+        // whether this build has the eventfd job waker, without which `loop_mode::single_threaded` keeps the locks
+        static bool supports_lock_free();
+
         template <typename Callable>
-        void call(Callable&& f)
+        void call(Callable&& f, job_prio prio = job_prio::latency)
         {
             if (in_event_loop())
             {
@@ -100,112 +400,209 @@ namespace wshttp
             }
             else
             {
-                call_soon(std::forward<Callable>(f));
+                call_soon(std::forward<Callable>(f), prio);
             }
         }
 
         template <typename Callable, typename Ret = decltype(std::declval<Callable>()())>
         Ret call_get(Callable&& f)
         {
-            if (in_event_loop())
+            // once the loop thread has been joined there is nothing left to race with
+            if (in_event_loop() or not running)
             {
                 return f();
             }
 
-            std::promise<Ret> prom;
-            auto fut = prom.get_future();
+            detail::call_slot<Ret> slot;
+
+            call_soon([&f, &slot] { slot.run(f); });
+
+            return slot.get();
+        }
+
+        /** Like `call_get`, but hands back a future instead of waiting on it, so that work can be posted to several
+            loops at once and joined together.
+         */
+        template <typename Callable, typename Ret = decltype(std::declval<Callable>()())>
+        std::future<Ret> call_async(Callable&& f)
+        {
+            std::promise<Ret> p;
+            auto fut = p.get_future();
 
-            call_soon([&f, &prom] {
+            auto run = [](Callable& f, std::promise<Ret>& p) {
                 try
                 {
-                    if constexpr (!std::is_void_v<Ret>)
-                        prom.set_value(f());
-                    else
+                    if constexpr (std::is_void_v<Ret>)
                     {
                         f();
-                        prom.set_value();
+                        p.set_value();
                     }
+                    else
+                        p.set_value(f());
                 }
                 catch (...)
                 {
-                    prom.set_exception(std::current_exception());
+                    p.set_exception(std::current_exception());
                 }
-            });
+            };
 
-            return fut.get();
+            if (in_event_loop() or not running)
+                run(f, p);
+            else
+                call_soon([run, f = std::forward<Callable>(f), p = std::move(p)]() mutable { run(f, p); });
+
+            return fut;
         }
 
         /** This invocation of `call_every` will return an EventHandler object from which the application can start and stop
             the repeated event. It is NOT tied to the lifetime of the caller via a weak_ptr.
 
             Configurable parameters:
-                - start_immediately : will call ::event_add() before returning the ticker
+                - start_immediately : will schedule the first execution before returning the ticker
                 - wait :
                     - if FALSE (default behavior), the interval will not wait for the event to complete. will attempt to
                         execute every `interval`, regardless of how long the event itself takes.
                     - if TRUE, the interval will wait for the event to complete before beginning. It will wait the entire
                         `interval` after finishing execution of the event before attempting execution again.
+                - res : resolution of the timer wheel the ticker runs on
         */
         template <typename Callable>
         [[nodiscard]] std::shared_ptr<ev_watcher> call_every(
-            std::chrono::microseconds interval, Callable&& f, bool start_immediately = true, bool wait = false)
+            std::chrono::microseconds interval,
+            Callable&& f,
+            bool start_immediately = true,
+            bool wait = false,
+            timer_res res = timer_res::fine)
         {
-            return _call_every(interval, std::forward<Callable>(f), event_loop::loop_id, start_immediately, wait);
+            return _call_every(
+                interval, std::forward<Callable>(f), event_loop::loop_id, start_immediately, wait, res);
         }
 
+        /** Schedules `hook` to run once after `delay` on the loop's timer wheel; the returned handle may be used to cancel
+            it. When invoked off the loop thread, the deadline is computed before dispatch, and the timer is scheduled
+            once the loop gets to it without waiting for that; the handle works in the meantime (see `timer_handle`).
+         */
         template <std::invocable Callable>
-        void call_later(std::chrono::microseconds delay, Callable hook)
+        timer_handle call_later(std::chrono::microseconds delay, Callable hook, timer_res res = timer_res::fine)
         {
-            if (in_event_loop())
+            auto target_time = detail::get_time() + delay;
+            auto h = timers(res).reserve(std::move(hook));
+
+            call([this, h, res, target_time]() { timers(res)._schedule(h, target_time); });
+
+            return h;
+        }
+
+        template <std::invocable Callable>
+        void call_soon(Callable f, job_prio prio = job_prio::latency)
+        {
+            if (prio == job_prio::latency)
             {
-                add_oneshot_event(delay, std::move(hook));
+                jobs_posted.fetch_add(1, std::memory_order_relaxed);
+                job_queue.push(std::move(f));
             }
             else
             {
-                call_soon([this, func = std::move(hook), target_time = detail::get_time() + delay]() mutable {
-                    auto now = detail::get_time();
-
-                    if (now >= target_time)
-                        func();
-                    else
-                        add_oneshot_event(
-                            std::chrono::duration_cast<std::chrono::microseconds>(target_time - now), std::move(func));
-                });
+                detail::queued_job j{std::move(f)};
+                j.after = jobs_posted.load(std::memory_order_relaxed);
+                bg_job_queue.push(std::move(j));
             }
+
+            if (not wake_pending.exchange(true, std::memory_order_acq_rel))
+                wake_loop();
         }
 
-        template <std::invocable Callable>
-        void call_soon(Callable f)
+        /** Caps the jobs run per wakeup of the job queue, by count and by elapsed time; whatever is left over stays
+            queued and runs after the loop has polled its sockets again. Zero leaves the respective limit unchanged.
+         */
+        void set_job_budget(size_t count, std::chrono::microseconds time = 0us)
         {
-            {
-                std::lock_guard lock{job_queue_mutex};
-                job_queue.emplace(std::move(f));
-            }
+            call_get([&]() {
+                if (count)
+                    job_budget_count = count;
+                if (time > 0us)
+                    job_budget_time = time;
+            });
+        }
+
+        /** Suspends the awaiting coroutine for `delay`; it resumes on the loop thread, whichever thread it was suspended
+            on */
+        sleep_awaiter sleep(std::chrono::microseconds delay, timer_res res = timer_res::fine)
+        {
+            return sleep_awaiter{*this, delay, res};
+        }
+
+        /** Continues the awaiting coroutine on the loop thread; a no-op if it is already running there */
+        resume_on_awaiter resume_on() { return resume_on_awaiter{*this}; }
+
+        /** Starts `t` on the loop thread without waiting for it. The task owns itself from here on and is destroyed when
+            it completes; an exception escaping it is logged.
+         */
+        void spawn(task<void> t)
+        {
+            if (not t)
+                throw std::invalid_argument{"Cannot spawn an empty task"};
+
+            auto h = t.release();
+            h.promise()._detached = true;
 
-            event_active(job_waker.get(), 0, 0);
+            call([h]() { h.resume(); });
+        }
+
+        /** Runs `t` on the loop thread and blocks the calling thread until it completes, returning its result or
+            rethrowing its exception. Must not be invoked from the loop thread itself.
+         */
+        template <typename T>
+        T block_on(task<T> t)
+        {
+            assert(not in_event_loop());
+
+            detail::call_slot<T> slot;
+            spawn(_drive(std::move(t), slot));
+            return slot.get();
         }
 
       private:
-        template <std::invocable Callable>
-        void add_oneshot_event(std::chrono::microseconds delay, Callable hook)
+        template <typename T>
+        static task<void> _drive(task<T> t, detail::call_slot<T>& slot)
         {
-            auto handler = make_handler(event_loop::loop_id);
-            auto& h = *handler;
-
-            h.init_event(
-                loop(),
-                delay,
-                [hndlr = std::move(handler), func = std::move(hook)]() mutable {
-                    auto h = std::move(hndlr);
-                    func();
-                    h.reset();
-                },
-                true);
+            std::exception_ptr err;
+
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    co_await std::move(t);
+                    slot.run([]() {});
+                }
+                else
+                {
+                    auto v = co_await std::move(t);
+                    slot.run([&v]() { return std::move(v); });
+                }
+            }
+            catch (...)
+            {
+                err = std::current_exception();
+            }
+
+            if (err)
+                slot.run([&err]() -> T { std::rethrow_exception(err); });
         }
 
-        void clear_old_tickers();
+        io_ring* ring() const { return uring.get(); }
 
-        std::shared_ptr<ev_watcher> make_handler(caller_id_t _id);
+        void mark_dirty(session_base& s);
+
+        // Drops `s` from the pending flush, for a session going away before it
+        void forget_dirty(session_base& s);
+
+        void flush_dirty();
+
+        timer_wheel& timers(timer_res res) { return res == timer_res::fine ? *fine_timers : *coarse_timers; }
+
+        // Registers `w` under `_id` with the tickers, on the loop thread
+        void add_handler(caller_id_t _id, const std::shared_ptr<ev_watcher>& w);
 
         bool in_event_loop() const { return std::this_thread::get_id() == loop_thread_id; }
 
@@ -217,7 +614,7 @@ namespace wshttp
         auto loop_deleter()
         {
             return [this](T* ptr) {
-                call([ptr] { delete ptr; });
+                call([ptr] { delete ptr; }, job_prio::background);
             };
         }
 
@@ -259,18 +656,78 @@ namespace wshttp
             std::chrono::microseconds interval,
             Callable&& f,
             caller_id_t _id,
-            bool start_immediately,
-            bool fixed_interval)
+            bool start_immediately = true,
+            bool fixed_interval = false,
+            timer_res res = timer_res::fine)
         {
-            auto h = make_handler(_id);
+            auto h = make_shared<ev_watcher>(*this);
 
-            h->init_event(loop(), interval, std::forward<Callable>(f), start_immediately, fixed_interval);
+            h->init_event(interval, std::forward<Callable>(f), start_immediately, fixed_interval, res);
+            add_handler(_id, h);
 
             return h;
         }
 
         void setup_job_waker();
 
+        void run();
+
+        void run_busy_poll();
+
+        // Runs one libevent pass; returns true if any callback ran
+        bool run_pass(int flags);
+
+        void wake_loop();
+
         void process_job_queue();
+
+        size_t run_jobs(
+            mpsc_queue<detail::queued_job>& q, size_t max, std::chrono::steady_clock::time_point deadline);
+
+        // Runs up to `max` background jobs whose latency-critical predecessors have all run
+        size_t run_background_jobs(size_t max, std::chrono::steady_clock::time_point deadline);
+
+        // whether the next background job may run (see `queued_job::after`)
+        bool background_ready();
+    };
+
+    /** Fixed set of event loops, each running on its own thread and, by default, pinned to its own core. An endpoint
+        made on a pool shards its listeners across every loop (see `endpoint::listen`): each loop accepts on its own
+        SO_REUSEPORT socket, and the sessions, streams and timers of an accepted connection then live and die on that
+        loop. The first loop is the pool's primary, which runs the endpoint itself and its outbound connections.
+     */
+    class event_loop_pool final
+    {
+        explicit event_loop_pool(size_t n, bool pin, std::optional<busy_poll_config> busy_poll, loop_mode mode);
+
+      public:
+        /** Starts `n` loops; zero starts one per hardware thread. With `pin`, loop `i` is pinned to core `i` (modulo the
+            number of hardware threads). `busy_poll` and `mode` are passed on to every loop.
+         */
+        [[nodiscard]] static std::shared_ptr<event_loop_pool> make(
+            size_t n = 0,
+            bool pin = true,
+            std::optional<busy_poll_config> busy_poll = std::nullopt,
+            loop_mode mode = loop_mode::threadsafe);
+
+        event_loop_pool(const event_loop_pool&) = delete;
+        event_loop_pool& operator=(const event_loop_pool&) = delete;
+
+      private:
+        std::vector<std::shared_ptr<event_loop>> _loops;
+        std::atomic<size_t> _next{0};
+
+      public:
+        size_t size() const { return _loops.size(); }
+
+        const std::shared_ptr<event_loop>& primary() const { return _loops.front(); }
+
+        const std::shared_ptr<event_loop>& operator[](size_t i) const { return _loops[i]; }
+
+        // Round-robin over every loop in the pool, for spreading new work
+        const std::shared_ptr<event_loop>& next();
+
+        auto begin() const { return _loops.begin(); }
+        auto end() const { return _loops.end(); }
     };
 }  // namespace wshttp
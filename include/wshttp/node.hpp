@@ -8,6 +8,84 @@ namespace wshttp
     class endpoint;
     class outbound_session;
     class app_context;
+    struct ev_watcher;
+
+    /** Outbound connection pool of a node; pass as an option to `endpoint::connect` to override the defaults.
+
+        A node multiplexes requests onto its sessions up to the peer's MAX_CONCURRENT_STREAMS each, picking the least
+        loaded one, and opens another connection to the host (up to `max_sessions`) only once all of them are full.
+        Sessions that have carried no stream for `idle_timeout` are closed; zero keeps them open until the peer closes.
+     */
+    struct pool_config
+    {
+        size_t max_sessions{4};
+        std::chrono::milliseconds idle_timeout{30'000};
+
+        // How often the node sweeps for idle sessions, on the coarse timer wheel
+        std::chrono::microseconds reap_interval() const
+        {
+            return std::max<std::chrono::microseconds>(idle_timeout / 4, 100ms);
+        }
+    };
+
+    namespace detail
+    {
+        template <typename Ptr>
+        struct session_choice
+        {
+            // session to take the request; null if a new connection should be made first
+            Ptr use{};
+
+            // least loaded session, should the new connection not be made
+            Ptr fallback{};
+        };
+
+        /** Pool policy behind `node::acquire_session`, over any sessions exposing `accepts_streams`, `active_streams`
+            and `stream_capacity`
+         */
+        template <typename Ptr>
+        session_choice<Ptr> choose_session(const std::vector<Ptr>& sessions, size_t max_sessions)
+        {
+            Ptr open{}, least{};
+
+            for (auto& s : sessions)
+            {
+                if (not s->accepts_streams())
+                    continue;
+
+                if (not least or s->active_streams() < least->active_streams())
+                    least = s;
+
+                if (s->active_streams() < s->stream_capacity()
+                    and (not open or s->active_streams() < open->active_streams()))
+                    open = s;
+            }
+
+            if (open)
+                return {open, open};
+
+            if (sessions.size() < max_sessions or not least)
+                return {nullptr, least};
+
+            return {least, least};
+        }
+
+        // Sessions of `sessions` that have carried no stream for `timeout`; copied, as closing one takes it out
+        template <typename Ptr>
+        std::vector<Ptr> idle_sessions(
+            const std::vector<Ptr>& sessions,
+            std::chrono::steady_clock::time_point now,
+            std::chrono::milliseconds timeout)
+        {
+            std::vector<Ptr> idle;
+
+            for (auto& s : sessions)
+                if (s->active_streams() == 0 and s->accepts_streams() and now - s->last_active() >= timeout)
+                    idle.push_back(s);
+
+            return idle;
+        }
+    }  //  namespace detail
 
     class node
     {
@@ -24,8 +102,8 @@ namespace wshttp
         template <typename... Opt>
         explicit node(endpoint& e, uri _u, Opt&&... opts) : _ep{e}, _uri{std::move(_u)}
         {
-            if (sizeof...(opts))
-                handle_nd_opts(std::forward<Opt>(opts)...);
+            if constexpr (sizeof...(opts))
+                (handle_nd_opt(std::forward<Opt>(opts)), ...);
             _init_internals();
             create_outbound_session();
         }
@@ -40,23 +118,39 @@ namespace wshttp
       private:
         endpoint& _ep;
         std::optional<ip_address> _local;
-        int _fd{-1};
 
         uri _uri;
 
-        // key: host, value: session ptr
-        std::unordered_map<std::string, std::shared_ptr<outbound_session>> _sessions;
+        pool_config _pool{};
+
+        // every session open (or connecting) to the host
+        std::vector<std::shared_ptr<outbound_session>> _sessions;
+
+        std::shared_ptr<ev_watcher> _reaper;
 
         void _init_internals();
 
-        void handle_nd_opts(ip_address local);
+        void handle_nd_opt(ip_address local);
+
+        void handle_nd_opt(pool_config pool);
+
+        // Socket bound to the configured local address for a new session; -1 lets the session create its own
+        evutil_socket_t bind_socket();
+
+        void reap_idle();
 
       protected:
         SSL* new_ssl();
 
-        void close_session(std::string host);
+        void close_session(outbound_session* s);
+
+        std::shared_ptr<outbound_session> create_outbound_session();
 
-        void create_outbound_session();
+        /** Session for the next request to the host: the least loaded one that is below the peer's stream limit, else a
+            new connection if the pool has room, else the least loaded one anyway (nghttp2 holds the request until one
+            of its streams closes). Returns nullptr only if a new connection could not be made.
+         */
+        std::shared_ptr<outbound_session> acquire_session();
     };
 }  //  namespace wshttp
 
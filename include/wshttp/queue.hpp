@@ -0,0 +1,238 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <queue>
+
+namespace wshttp
+{
+    inline constexpr size_t CACHE_LINE_SIZE{64};
+
+    /** Multi-producer, single-consumer FIFO used to post jobs onto the event loop thread.
+
+        The fast path is a bounded ring (Vyukov-style, per-cell sequence numbers): producers claim a slot with a single
+        CAS on the enqueue cursor, write the value in place, and publish it with a release store on the cell sequence.
+        The consumer never CAS's; it owns the dequeue cursor outright.
+
+        If the ring is full, producers spill into a mutex-guarded overflow queue. While the overflow is non-empty, every
+        producer keeps spilling so per-producer FIFO order is preserved; the consumer always drains the ring before the
+        overflow, and re-arms the fast path once the overflow is empty. Spilled items the consumer takes over but does
+        not get to within one bounded `drain` are held on its side and run ahead of the ring next time.
+     */
+    template <typename T>
+    class mpsc_queue
+    {
+        struct cell
+        {
+            std::atomic<size_t> seq;
+            alignas(T) std::byte storage[sizeof(T)];
+
+            T* get() { return std::launder(reinterpret_cast<T*>(storage)); }
+        };
+
+      public:
+        static constexpr size_t DEFAULT_CAPACITY{1 << 12};
+
+        explicit mpsc_queue(size_t capacity = DEFAULT_CAPACITY)
+            : _mask{std::bit_ceil(std::max<size_t>(capacity, 2)) - 1}, _cells{new cell[_mask + 1]}
+        {
+            for (size_t i = 0; i <= _mask; ++i)
+                _cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        mpsc_queue(const mpsc_queue&) = delete;
+        mpsc_queue& operator=(const mpsc_queue&) = delete;
+        mpsc_queue(mpsc_queue&&) = delete;
+        mpsc_queue& operator=(mpsc_queue&&) = delete;
+
+        ~mpsc_queue()
+        {
+            while (_pop_ring())
+                ;
+        }
+
+        // Callable from any thread
+        template <typename... Args>
+        void push(Args&&... args)
+        {
+            if (not _overflowed.load(std::memory_order_acquire) and _try_push_ring(std::forward<Args>(args)...))
+                return;
+
+            std::lock_guard lock{_overflow_mutex};
+            _overflow.emplace(std::forward<Args>(args)...);
+            _overflowed.store(true, std::memory_order_release);
+        }
+
+        /** Consumer-only. Invokes `f` on up to `max` queued items, oldest first, and returns the number processed. Items
+            pushed by `f` itself (or concurrently) past that bound are left for the next call.
+         */
+        template <std::invocable<T&> Callable>
+        size_t drain(Callable&& f, size_t max = std::numeric_limits<size_t>::max())
+        {
+            // leftovers from a previous bounded drain predate everything now in the ring
+            size_t n = _drain_spilled(f, max);
+
+            if (not _spilled.empty())
+                return n;
+
+            for (; n < max; ++n)
+            {
+                auto* c = _front();
+                if (not c)
+                    break;
+
+                T item{std::move(*c->get())};
+                _release(c);
+                f(item);
+            }
+
+            // the overflow only ever holds items newer than everything in the ring, so it is touched only once the ring
+            // is fully drained (no claimed-but-unpublished slots either)
+            if (n < max and _overflowed.load(std::memory_order_acquire)
+                and _enqueue_pos.load(std::memory_order_acquire) == _dequeue_pos.load(std::memory_order_relaxed))
+            {
+                {
+                    std::lock_guard lock{_overflow_mutex};
+                    _spilled.swap(_overflow);
+                    _overflowed.store(false, std::memory_order_release);
+                }
+
+                n += _drain_spilled(f, max - n);
+            }
+
+            return n;
+        }
+
+        /** Consumer-only. The oldest queued item, left in place for a following `drain` to run, or nullptr if there is
+            none (or the next one is still being published).
+         */
+        T* front()
+        {
+            if (not _spilled.empty())
+                return &_spilled.front();
+
+            if (auto* c = _front())
+                return c->get();
+
+            if (_overflowed.load(std::memory_order_acquire)
+                and _enqueue_pos.load(std::memory_order_acquire) == _dequeue_pos.load(std::memory_order_relaxed))
+            {
+                {
+                    std::lock_guard lock{_overflow_mutex};
+                    _spilled.swap(_overflow);
+                    _overflowed.store(false, std::memory_order_release);
+                }
+
+                if (not _spilled.empty())
+                    return &_spilled.front();
+            }
+
+            return nullptr;
+        }
+
+        // Approximate number of queued items; exact only when no producer is mid-push. Consumer-side only
+        size_t size_approx() const
+        {
+            auto d = _dequeue_pos.load(std::memory_order_acquire);
+            auto e = _enqueue_pos.load(std::memory_order_acquire);
+            return (e > d ? e - d : 0) + _spilled.size() + (_overflowed.load(std::memory_order_relaxed) ? 1 : 0);
+        }
+
+        bool empty() const { return size_approx() == 0; }
+
+        size_t capacity() const { return _mask + 1; }
+
+      private:
+        const size_t _mask;
+        std::unique_ptr<cell[]> _cells;
+
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueue_pos{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeue_pos{0};
+
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> _overflowed{false};
+        std::mutex _overflow_mutex;
+        std::queue<T> _overflow;
+
+        // consumer-owned: overflow items taken out from under the lock, not yet run
+        std::queue<T> _spilled;
+
+        template <typename Callable>
+        size_t _drain_spilled(Callable& f, size_t max)
+        {
+            size_t n{0};
+
+            for (; n < max and not _spilled.empty(); ++n)
+            {
+                T item{std::move(_spilled.front())};
+                _spilled.pop();
+                f(item);
+            }
+
+            return n;
+        }
+
+        template <typename... Args>
+        bool _try_push_ring(Args&&... args)
+        {
+            auto pos = _enqueue_pos.load(std::memory_order_relaxed);
+            cell* c;
+
+            for (;;)
+            {
+                c = &_cells[pos & _mask];
+                auto seq = c->seq.load(std::memory_order_acquire);
+                auto dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+                if (dif == 0)
+                {
+                    if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (dif < 0)
+                    return false;  // full
+                else
+                    pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+
+            new (c->storage) T(std::forward<Args>(args)...);
+            c->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        cell* _front()
+        {
+            auto pos = _dequeue_pos.load(std::memory_order_relaxed);
+            auto* c = &_cells[pos & _mask];
+
+            // a slot that is claimed but not yet published reads as empty; its producer wakes the loop once done
+            if (c->seq.load(std::memory_order_acquire) != pos + 1)
+                return nullptr;
+
+            return c;
+        }
+
+        void _release(cell* c)
+        {
+            auto pos = _dequeue_pos.load(std::memory_order_relaxed);
+            c->get()->~T();
+            c->seq.store(pos + _mask + 1, std::memory_order_release);
+            _dequeue_pos.store(pos + 1, std::memory_order_release);
+        }
+
+        bool _pop_ring()
+        {
+            if (auto* c = _front())
+            {
+                _release(c);
+                return true;
+            }
+            return false;
+        }
+    };
+}  //  namespace wshttp
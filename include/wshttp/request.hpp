@@ -23,6 +23,11 @@ namespace wshttp
             inline constexpr auto get = "GET"_usp;
         }   //  namespace types
 
+        namespace scheme
+        {
+            inline constexpr auto https = "https"_usp;
+        }  //  namespace scheme
+
         namespace code
         {
             inline constexpr auto HTTP_200 = "200"_usp;
@@ -43,6 +48,7 @@ namespace wshttp
             size_t _index{};
 
           public:
+            headers() = default;
             headers(uspan name, uspan val, nghttp2_nv_flag flags = NGHTTP2_NV_FLAG_NONE);
             headers(FIELD f, uspan val, nghttp2_nv_flag flags = NGHTTP2_NV_FLAG_NONE);
 
@@ -110,4 +116,47 @@ namespace wshttp
             }
         };
     }  // namespace req
+
+    /** Produces the body of an outbound request, invoked on the loop thread whenever the session can send more of it:
+        fills `buf`, returns the number of bytes written, and sets `eof` along with the last of them. Returning
+        NGHTTP2_ERR_DEFERRED pauses the body until `stream::resume_body()`; any other negative value resets the stream.
+     */
+    using body_provider = std::function<nghttp2_ssize(std::span<uint8_t> buf, bool& eof)>;
+
+    /** Outbound request, for `endpoint::submit`. Header names must be lowercase, as HTTP/2 requires; `:scheme` and
+        `:authority` are filled in from the session's host.
+     */
+    struct request
+    {
+        std::string method{"GET"};
+        std::string path{"/"};
+        std::vector<std::pair<std::string, std::string>> headers{};
+        body_provider body{};
+
+        // Body provider sending `data`, e.g. for small POST payloads
+        static body_provider from(std::string data);
+    };
+
+    // Response to an outbound request, as received so far
+    struct response
+    {
+        uint32_t status{0};
+        std::vector<std::pair<std::string, std::string>> headers{};
+
+        // error code of the RST_STREAM or GOAWAY that ended the stream; NGHTTP2_NO_ERROR once it completed normally
+        uint32_t error_code{NGHTTP2_NO_ERROR};
+    };
+
+    /** Callbacks for the response to an outbound request, all invoked on the loop thread; any may be left unset.
+            - on_headers : once the (final, non-1xx) response header block has arrived
+            - on_data : for each body chunk, as a view into the session's input that is only valid during the call;
+                without it, chunks are kept in the stream's `body()` until the application consumes them
+            - on_close : once the stream has closed, normally or not; see `response::error_code`
+     */
+    struct response_handler
+    {
+        std::function<void(const response&)> on_headers{};
+        std::function<void(uspan chunk)> on_data{};
+        std::function<void(const response&)> on_close{};
+    };
 }  //  namespace wshttp
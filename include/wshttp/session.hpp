@@ -3,6 +3,7 @@
 #include "address.hpp"
 #include "concepts.hpp"
 #include "context.hpp"
+#include "coro.hpp"
 #include "listener.hpp"
 #include "node.hpp"
 #include "request.hpp"
@@ -12,20 +13,26 @@ namespace wshttp
     class node;
     class stream;
     class endpoint;
+    class event_loop;
+    struct h2_settings;
 
     class session_base
     {
         friend class stream;
         friend class listener;
         friend struct session_callbacks;
+        friend class event_loop;
 
       protected:
-        session_base(endpoint& e, evutil_socket_t f, path _p, bool d)
-            : _ep{e}, _fd{f}, _path{std::move(_p)}, _is_outbound{d}
+        session_base(endpoint& e, event_loop& l, evutil_socket_t f, path _p, bool d)
+            : _ep{e}, _loop{l}, _fd{f}, _path{std::move(_p)}, _is_outbound{d}
         {}
 
         endpoint& _ep;
 
+        // the loop this session (and its streams) live on; for inbound sessions, that of the accepting listener
+        event_loop& _loop;
+
         evutil_socket_t _fd;
 
         path _path;
@@ -38,16 +45,63 @@ namespace wshttp
 
         bool _is_outbound{false};
 
+        // whether the kernel took over TLS record crypto in either direction; set once the handshake completes
+        bool _ktls_send{false};
+        bool _ktls_recv{false};
+
+        // Whether the socket can take a direct kTLS send. A short send leaves the rest of the payload to the
+        // bufferevent (its write callback sets this again); a blocked frame header waits on `_writable_ev` instead
+        bool _sock_writable{true};
+
+        // set while OpenSSL holds a frame header that must be retried before anything else is written
+        bool _ktls_hd_pending{false};
+        event_ptr _writable_ev;
+
+        // current output high watermark; fixed at the endpoint's unless its watermarks are adaptive
+        size_t _high_water{0};
+
+        // bytes handed to the output buffer so far, and the start of the current throughput sample
+        uint64_t _bytes_queued{0};
+        uint64_t _sample_sent{0};
+        std::chrono::steady_clock::time_point _sample_start{};
+
+        // input block being fed to nghttp2, which received body chunks borrow from; see `recv_chunk`
+        input_block_ptr _recv_block;
+
+        // set while queued on the loop's dirty list, waiting for its end-of-iteration flush
+        bool _send_scheduled{false};
+
         void read_session_data();
 
         void write_session_data();
 
         void send_session_data();
 
-        nghttp2_ssize send_hook(ustring data);
+        // Defers sending whatever nghttp2 has queued to the end of the loop iteration, so frames submitted by several
+        // callbacks (and every stream of the session) go out in one pass rather than one small write each
+        void schedule_send();
+
+        void flush();
+
+        void apply_watermarks();
+
+        void adapt_watermarks(size_t outlen);
+
+        void check_tls_offload();
+
+        // Writes a NO_COPY DATA frame straight to the socket: its header, then `length` bytes at `offset` of `fd`.
+        // Returns the payload bytes sent (possibly short), NGHTTP2_ERR_WOULDBLOCK if the header could not be sent, or a
+        // fatal nghttp2 error
+        nghttp2_ssize sendfile_data(const uint8_t* framehd, int fd, uint64_t offset, size_t length);
+
+        // Marks the socket full, and has the session send again once it turns writable
+        void wait_writable();
 
         void config_send_initial();
 
+        // Submits `s` and grows the connection receive window to match; sent with the next session data
+        void submit_settings(const h2_settings& s);
+
         virtual void initialize_session() = 0;
 
         virtual void send_initial() = 0;
@@ -66,12 +120,17 @@ namespace wshttp
         bool is_outbound() const { return _is_outbound; }
 
       public:
-        virtual ~session_base() = default;
+        virtual ~session_base();
 
         const ip_address& local() const { return _path.local(); }
         const ip_address& remote() const { return _path.remote(); }
         const path& session_path() const { return _path; }
 
+        // Whether TLS records are encrypted (sent) or decrypted (received) by the kernel rather than by OpenSSL; see
+        // `tls_mode`. Only meaningful once the session has connected
+        bool ktls_send() const { return _ktls_send; }
+        bool ktls_recv() const { return _ktls_recv; }
+
         template <concepts::nghttp2_session_type T>
         operator const T*() const
         {
@@ -90,12 +149,13 @@ namespace wshttp
         friend class stream;
         friend class listener;
         friend struct session_callbacks;
+        friend class event_loop;
 
       public:
         inbound_session() = delete;
 
         inbound_session(listener& l, ip_address remote, evutil_socket_t fd)
-            : session_base{l._ep, fd, path{{}, std::move(remote)}, false}, _lst{l}
+            : session_base{l._ep, l._loop, fd, path{{}, std::move(remote)}, false}, _lst{l}
         {
             _init_internals();
         }
@@ -137,22 +197,51 @@ namespace wshttp
         friend class stream;
         friend class node;
         friend struct session_callbacks;
+        friend class event_loop;
 
       public:
-        outbound_session(node& n, evutil_socket_t fd, std::optional<ip_address> local = std::nullopt)
-            : session_base{n._ep, fd, path{local ? std::move(*local) : ip_address{}, {}}, true},
-              _n{n},
-              _host{_n._uri.host()}
-        {
-            _init_internals();
-        }
+        outbound_session(node& n, evutil_socket_t fd, std::optional<ip_address> local = std::nullopt);
 
         ~outbound_session();
 
+        /** Resolves to true once the session has connected and negotiated h2, or to false if it failed or closed first.
+            Must be awaited on the loop thread.
+         */
+        async_latch<bool>::awaiter connected() { return _connected.wait(); }
+
+        /** Submits `req` on this session, or queues it until the session has connected. The response is delivered
+            through `handler` and the returned stream (see `stream::finished()`, `stream::body()`). Returns
+            nullptr if the session no longer accepts requests or nghttp2 refused it. Must be invoked on the loop thread.
+         */
+        std::shared_ptr<stream> submit(request req, response_handler handler = {});
+
+        // Streams currently open on the session, or waiting for it to connect
+        size_t active_streams() const { return _streams.size() + _pending.size(); }
+
+        // Streams the peer lets the session have open at once; its MAX_CONCURRENT_STREAMS once known
+        uint32_t stream_capacity() const;
+
+        // Whether new requests may go to the session: false once it is closing, or either side has sent GOAWAY
+        bool accepts_streams() const;
+
+        // When the session last connected or had a stream close
+        std::chrono::steady_clock::time_point last_active() const { return _last_active; }
+
       protected:
         node& _n;
         std::string _host;
 
+        async_latch<bool> _connected;
+
+        // requests submitted while connecting, sent once connected
+        std::vector<std::shared_ptr<stream>> _pending;
+
+        std::chrono::steady_clock::time_point _last_active{std::chrono::steady_clock::now()};
+        bool _closing{false};
+
+        // whether the peer's SETTINGS, and so its stream limit, have arrived
+        bool _peer_settings{false};
+
         void _init_internals();
 
         void initialize_session() override;
@@ -167,10 +256,15 @@ namespace wshttp
 
         int stream_close_hook(int32_t stream_id, uint32_t error_code = 0) override;
 
+        int submit_stream(const std::shared_ptr<stream>& s);
+
         void on_connect();
 
         void close_session() override;
 
+        // Sends GOAWAY and closes the session once it has gone out
+        void shutdown();
+
       private:
         uri& get_uri() { return _n._uri; }
     };
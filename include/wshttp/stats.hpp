@@ -0,0 +1,154 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace wshttp
+{
+    /** Point-in-time copy of a `histogram`. Bucket 0 counts zero values; bucket `i` counts values in [2^(i-1), 2^i).
+        Snapshots are cumulative since the loop started; subtract an earlier snapshot to get the figures for a window.
+     */
+    struct histogram_snapshot
+    {
+        static constexpr size_t NUM_BUCKETS{48};
+
+        std::array<uint64_t, NUM_BUCKETS> buckets{};
+        uint64_t count{0};
+        uint64_t sum{0};
+        uint64_t max{0};  // maximum since the loop started, also for windows
+
+        double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+        // Upper bound of the bucket holding the `p`-th quantile (0 <= p <= 1), clamped to the maximum seen
+        uint64_t percentile(double p) const
+        {
+            if (count == 0)
+                return 0;
+
+            auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+            uint64_t seen{0};
+
+            for (size_t i = 0; i < NUM_BUCKETS; ++i)
+                if (seen += buckets[i]; seen >= rank)
+                    return i == 0 ? 0 : std::min(max, (uint64_t{1} << i) - 1);
+
+            return max;
+        }
+
+        histogram_snapshot& operator-=(const histogram_snapshot& earlier)
+        {
+            for (size_t i = 0; i < NUM_BUCKETS; ++i)
+                buckets[i] -= earlier.buckets[i];
+            count -= earlier.count;
+            sum -= earlier.sum;
+            return *this;
+        }
+
+        friend histogram_snapshot operator-(histogram_snapshot later, const histogram_snapshot& earlier)
+        {
+            return later -= earlier;
+        }
+
+        std::string to_string() const;
+        static constexpr bool to_string_formattable = true;
+    };
+
+    /** Log2-bucketed histogram with a single writer (the event loop thread) and any number of lock-free readers. The
+        writer never issues a locked read-modify-write: each counter has exactly one writer, so a relaxed load + store
+        suffices, and readers on other threads see every counter move monotonically.
+     */
+    class histogram
+    {
+        std::array<std::atomic<uint64_t>, histogram_snapshot::NUM_BUCKETS> _buckets{};
+        std::atomic<uint64_t> _sum{0};
+        std::atomic<uint64_t> _max{0};
+
+        static void _bump(std::atomic<uint64_t>& a, uint64_t by)
+        {
+            a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+
+      public:
+        // Writer thread only
+        void record(uint64_t v)
+        {
+            _bump(_buckets[std::min<size_t>(std::bit_width(v), histogram_snapshot::NUM_BUCKETS - 1)], 1);
+            _bump(_sum, v);
+            if (v > _max.load(std::memory_order_relaxed))
+                _max.store(v, std::memory_order_relaxed);
+        }
+
+        void record(std::chrono::nanoseconds d) { record(static_cast<uint64_t>(std::max(d.count(), int64_t{0}))); }
+
+        // Any thread
+        histogram_snapshot snapshot() const
+        {
+            histogram_snapshot s;
+
+            for (size_t i = 0; i < s.NUM_BUCKETS; ++i)
+                s.count += s.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+            s.sum = _sum.load(std::memory_order_relaxed);
+            s.max = _max.load(std::memory_order_relaxed);
+
+            return s;
+        }
+    };
+
+    /** Snapshot of an event loop's instrumentation, from `event_loop::stats()`. Durations are in nanoseconds.
+            - queue_depth : jobs waiting (both priority classes) each time the loop woke up to run them
+            - job_wait : time from `call_soon` until the job started running
+            - job_run : run time of each job
+            - callback : run time of each libevent callback the loop dispatches (sockets, listeners, the job queue and
+                timer wheels as a whole)
+            - timer_lag : how late each timer fired, past the wheel tick it was due on
+            - iteration : busy time of each loop iteration, from the first callback after waking until going back to
+                sleep
+     */
+    struct loop_stats
+    {
+        histogram_snapshot queue_depth;
+        histogram_snapshot job_wait;
+        histogram_snapshot job_run;
+        histogram_snapshot callback;
+        histogram_snapshot timer_lag;
+        histogram_snapshot iteration;
+
+        friend loop_stats operator-(loop_stats later, const loop_stats& earlier)
+        {
+            later.queue_depth -= earlier.queue_depth;
+            later.job_wait -= earlier.job_wait;
+            later.job_run -= earlier.job_run;
+            later.callback -= earlier.callback;
+            later.timer_lag -= earlier.timer_lag;
+            later.iteration -= earlier.iteration;
+            return later;
+        }
+    };
+
+    // Live counterpart of `loop_stats`, written by the loop thread
+    struct loop_histograms
+    {
+        histogram queue_depth;
+        histogram job_wait;
+        histogram job_run;
+        histogram callback;
+        histogram timer_lag;
+        histogram iteration;
+
+        loop_stats snapshot() const
+        {
+            return {
+                queue_depth.snapshot(),
+                job_wait.snapshot(),
+                job_run.snapshot(),
+                callback.snapshot(),
+                timer_lag.snapshot(),
+                iteration.snapshot()};
+        }
+    };
+}  //  namespace wshttp
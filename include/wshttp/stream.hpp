@@ -1,14 +1,116 @@
 #pragma once
 
 #include "address.hpp"
+#include "coro.hpp"
 #include "request.hpp"
 #include "types.hpp"
 
+#include <sys/uio.h>
+
+#include <deque>
+
 namespace wshttp
 {
     class session_base;
     class inbound_session;
     class outbound_session;
+    class event_loop;
+
+    /** Received body bytes, borrowed from the block of session input they were decrypted into rather than copied out
+        of it. Holding a chunk keeps its whole block alive (up to one socket read's worth), not just these bytes.
+     */
+    struct recv_chunk
+    {
+        input_block_ptr block;
+        uspan data;
+    };
+
+    /** Response body received on an outbound stream, as a sequence of refcounted chunks to be consumed incrementally:
+        look at the buffered bytes with `peek` or `chunks`, then release them with `stream::consume`, which is also what
+        returns flow-control credit to the peer. Bytes left unconsumed stop the peer once its window runs out.
+
+        Must only be used on the loop thread.
+     */
+    class recv_buffer
+    {
+        friend class stream;
+        friend struct recv_buffer_tester;
+
+      public:
+        struct awaiter
+        {
+            recv_buffer* _b;
+            std::coroutine_handle<> _h{};
+            detail::pending_resume _wake{};
+            bool _readable{false};
+
+            // as with async_channel, a coroutine destroyed while suspended here is neither resumed nor left registered
+            ~awaiter()
+            {
+                if (_wake)
+                    *_wake = nullptr;
+                else if (_h and _b->_waiter == this)
+                    _b->_waiter = nullptr;
+            }
+
+            bool await_ready()
+            {
+                _readable = not _b->empty();
+                return _readable or _b->_closed;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                _h = h;
+                _b->_waiter = this;
+            }
+
+            // whether bytes were buffered when woken; the buffer may be gone by the time the coroutine resumes
+            bool await_resume() const { return _readable; }
+        };
+
+      private:
+        event_loop& _loop;
+        std::deque<recv_chunk> _chunks;
+        size_t _size{0};
+        bool _closed{false};
+        awaiter* _waiter{nullptr};
+
+        explicit recv_buffer(event_loop& l) : _loop{l} {}
+
+        void push(recv_chunk c);
+
+        void close();
+
+        // Hands the waiter, if any, its result and resumes it from a fresh loop job
+        void _resume_waiter();
+
+        // Drops up to `n` bytes from the front; returns how many were dropped
+        size_t pop(size_t n);
+
+      public:
+        recv_buffer(const recv_buffer&) = delete;
+        recv_buffer& operator=(const recv_buffer&) = delete;
+
+        // a coroutine still awaiting `readable()` when the stream goes away resumes as if the stream had closed
+        ~recv_buffer() { close(); }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        // Whether the stream has closed, i.e. nothing more will be buffered
+        bool closed() const { return _closed; }
+
+        const std::deque<recv_chunk>& chunks() const { return _chunks; }
+
+        // Fills `out` with the buffered bytes, oldest first and one entry per chunk; returns the number of entries set
+        size_t peek(std::span<iovec> out) const;
+
+        /** Resolves to true once bytes are buffered, or to false once the stream has closed (or been destroyed) and all
+            were consumed
+         */
+        awaiter readable() { return awaiter{this}; }
+    };
 
     class stream
     {
@@ -16,10 +118,12 @@ namespace wshttp
         friend class inbound_session;
         friend class outbound_session;
         friend struct session_callbacks;
+        friend struct stream_callbacks;
 
-        stream(inbound_session& s, const session_ptr& _s, int32_t id = 0);
+        stream(inbound_session& s, int32_t id);
 
-        stream(outbound_session& s, const session_ptr& _s, int32_t id = 0);
+        // Outbound stream for `req`; it gets its ID once submitted
+        stream(outbound_session& s, request req, response_handler h);
 
         // No copy, no move; always hold in shared_ptr using static ::make()
         stream(const stream&) = delete;
@@ -28,11 +132,10 @@ namespace wshttp
         stream& operator=(stream&&) = delete;
 
       public:
-        ~stream() = default;
+        ~stream();
 
       private:
         session_base& _s;
-        session_ptr _session;
 
         IO dir;
 
@@ -40,13 +143,44 @@ namespace wshttp
         int _fd{-1};
         std::array<int, 2> _pipes{};
 
+        // body of a regular file response, sent straight from the file without passing through nghttp2's buffers;
+        // `_file_sent` counts the bytes already queued on the session output
+        file_segment_ptr _file;
+        int _file_fd{-1};  // owned by `_file`
+        uint64_t _file_size{0};
+        uint64_t _file_sent{0};
+
         uri _req;
 
-        int recv_data(ustring data);
+        // outbound request as submitted; its header block refers to these strings rather than copying them
+        request _out;
+        req::headers _out_hdrs;
+
+        response _resp;
+        response_handler _handler;
+        async_latch<response> _done;
+        bool _headers_done{false};
+        bool _closed{false};
+
+        // response body received on an outbound stream without an `on_data` handler, until consumed
+        recv_buffer _body;
+
+        // set once the stream is on a connected session; lets `consume` outlive the session safely
+        std::weak_ptr<nghttp2_session> _nghttp2;
+
+        nghttp2_session* session() const;
+
+        int submit_request(std::string_view authority);
+
+        int recv_data(recv_chunk data);
 
         int recv_path_header(uspan path);
 
-        int recv_header(req::headers hdr);
+        int recv_header(uspan name, uspan value);
+
+        int recv_response();
+
+        void recv_close(uint32_t error_code);
 
         int recv_frame();
 
@@ -54,14 +188,36 @@ namespace wshttp
 
         int send_response(req::headers hdr);
 
+        int send_file_response(req::headers hdr, uint64_t size);
+
       public:
         int fd() const { return _fd; }
+
+        // Zero for an outbound stream not yet submitted, i.e. whose session is still connecting
+        int32_t id() const { return _id; }
+
+        /** Resolves to the response once the (outbound) stream has closed, normally or not; see
+            `response::error_code`. Must be awaited on the loop thread.
+         */
+        async_latch<response>::awaiter finished() { return _done.wait(); }
+
+        // Resumes a request body whose provider returned NGHTTP2_ERR_DEFERRED; only while the stream is open
+        void resume_body();
+
+        /** Response body received on this (outbound) stream and not consumed yet; only used for requests submitted
+            without an `on_data` handler. Must be used on the loop thread.
+         */
+        recv_buffer& body() { return _body; }
+
+        // Releases the first `n` bytes of `body()`, returning their flow-control credit to the peer
+        void consume(size_t n);
     };
     namespace deleters
     {
         inline constexpr auto stream_d = [](stream* s) {
-            if (s->fd() == -1)
+            if (s->fd() != -1)
                 close(s->fd());
+            delete s;
         };
     }
 
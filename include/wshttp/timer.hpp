@@ -0,0 +1,204 @@
+#pragma once
+
+#include "job.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace wshttp
+{
+    class event_loop;
+    class timer_wheel;
+
+    /** Timer granularity:
+            - fine : 1ms ticks, for request/stream level deadlines
+            - coarse : 100ms ticks, for idle/keepalive style timeouts; coalesces wakeups at the cost of precision
+     */
+    enum class timer_res { fine, coarse };
+
+    inline constexpr auto FINE_TIMER_TICK{1ms};
+    inline constexpr auto COARSE_TIMER_TICK{100ms};
+
+    struct timer_id
+    {
+        uint32_t index{std::numeric_limits<uint32_t>::max()};
+        uint32_t gen{0};
+    };
+
+    /** Cancellable reference to a timer scheduled on a timer_wheel. Handles are cheap to copy, never keep the wheel
+        alive, and are safe to use from any thread without ever blocking on the loop; a handle to a timer that already
+        fired (or a wheel that has been destroyed) simply reports that there is nothing left to cancel.
+
+        A handle may be handed out before its timer is on the wheel, as `event_loop::call_later` does off the loop
+        thread. The state shared with the wheel records the outcome either way: a timer cancelled before it is scheduled
+        never is, and one cancelled while its unlinking is still on the way to the loop is skipped when due.
+     */
+    class timer_handle
+    {
+        friend class timer_wheel;
+
+        struct state
+        {
+            enum : uint8_t
+            {
+                PENDING,
+                FIRED,
+                CANCELLED
+            };
+
+            state(std::weak_ptr<timer_wheel> w, Job f) : wheel{std::move(w)}, f{std::move(f)} {}
+
+            std::atomic<uint8_t> status{PENDING};
+            const std::weak_ptr<timer_wheel> wheel;
+
+            // loop thread only, once handed out: the callback until it moves onto the wheel, and the timer's id after
+            Job f;
+            timer_id id{};
+        };
+
+        std::shared_ptr<state> _state;
+
+        explicit timer_handle(std::shared_ptr<state> s) : _state{std::move(s)} {}
+
+      public:
+        timer_handle() = default;
+
+        /** Cancels the timer
+            Returns:
+                - true: timer was pending and will not fire again
+                - false: timer already fired (one-shot), was already cancelled, or the wheel is gone
+         */
+        bool cancel();
+
+        bool pending() const;
+    };
+
+    /** Hierarchical timing wheel driven by a single libevent timer.
+
+        Level 0 has 256 slots of one tick each; levels 1-4 have 64 slots, each slot spanning 64x the slots of the level
+        beneath it, giving a horizon of 2^32 ticks. Scheduling and cancelling are O(1): timers live in a slab indexed by
+        `timer_id`, linked into their slot by index, and a generation counter invalidates stale handles. Timers in upper
+        levels are cascaded down as level 0 wraps. The libevent event is only armed while timers are pending, for the
+        next occupied level 0 slot (or the next cascade point).
+
+        All methods prefixed with an underscore must be invoked on the event loop thread.
+     */
+    class timer_wheel : public std::enable_shared_from_this<timer_wheel>
+    {
+        friend class event_loop;
+        friend class timer_handle;
+        friend struct ev_watcher;
+        friend struct loop_callbacks;
+        friend struct sleep_awaiter;
+        friend struct timer_wheel_tester;
+
+        static constexpr int L0_BITS{8};
+        static constexpr int LN_BITS{6};
+        static constexpr int LEVELS{5};
+        static constexpr uint64_t L0_SIZE{1 << L0_BITS};
+        static constexpr uint64_t LN_SIZE{1 << LN_BITS};
+        static constexpr uint64_t L0_MASK{L0_SIZE - 1};
+        static constexpr uint64_t LN_MASK{LN_SIZE - 1};
+        static constexpr size_t NUM_SLOTS{L0_SIZE + (LEVELS - 1) * LN_SIZE};
+        static constexpr uint64_t MAX_DELTA{(uint64_t{1} << (L0_BITS + (LEVELS - 1) * LN_BITS)) - 1};
+
+        static constexpr uint32_t NIL{std::numeric_limits<uint32_t>::max()};
+        static constexpr uint64_t UNARMED{std::numeric_limits<uint64_t>::max()};
+
+        struct node
+        {
+            Job f;
+            std::shared_ptr<timer_handle::state> handle;  // null for timers that are never handed out
+            uint64_t expires{0};
+            uint64_t interval{0};  // in ticks; zero for one-shot timers
+            uint32_t gen{0};
+            uint32_t prev{NIL};
+            uint32_t next{NIL};
+            uint16_t slot{0};
+            bool linked{false};
+            bool live{false};
+            bool wait{false};
+        };
+
+        timer_wheel(event_loop& l, loop_ptr base, std::chrono::microseconds tick);
+
+      public:
+        ~timer_wheel();
+
+        std::chrono::microseconds tick() const { return _tick; }
+
+        // Number of pending timers; loop thread only
+        size_t size() const { return _count; }
+
+      private:
+        event_loop& _loop;
+        loop_ptr _base;
+        event_ptr _ev;
+
+        const std::chrono::microseconds _tick;
+        const std::chrono::steady_clock::time_point _origin;
+
+        uint64_t _next_tick{0};  // next tick to be processed
+        uint64_t _armed{UNARMED};
+        size_t _count{0};
+
+        std::vector<node> _slab;
+        std::vector<uint32_t> _free;
+        std::vector<uint32_t> _refile;  // repeating timers fired from the slot being drained
+
+        std::array<uint32_t, NUM_SLOTS> _slots;
+        std::array<uint64_t, L0_SIZE / 64> _l0_occupied{};
+
+        static std::shared_ptr<timer_wheel> make(event_loop& l, loop_ptr base, std::chrono::microseconds tick);
+
+        // Handle for a timer running `f`, yet to be scheduled through `_schedule`; callable from any thread
+        timer_handle reserve(Job f);
+
+        // Schedules the timer reserved as `h`, unless it was cancelled in the meantime
+        void _schedule(
+            const timer_handle& h,
+            std::chrono::steady_clock::time_point when,
+            std::chrono::microseconds interval = 0us,
+            bool wait = false);
+
+        timer_handle _schedule(
+            std::chrono::steady_clock::time_point when,
+            Job f,
+            std::chrono::microseconds interval = 0us,
+            bool wait = false);
+
+        bool _cancel(timer_id id);
+
+        bool _pending(timer_id id) const;
+
+        void _advance();
+
+        // Processes every tick up to and including `target`
+        void _advance_to(uint64_t target);
+
+        void _rearm();
+
+        // Whether the cursor sits on a block boundary whose cascade still has timers to bring down
+        bool _cascade_pending() const;
+
+        uint64_t _next_occupied(uint64_t index) const;
+
+        uint64_t _next_due() const;
+
+        uint64_t _ticks_until(std::chrono::steady_clock::time_point t, bool round_up) const;
+
+        void _link(uint32_t idx);
+
+        void _unlink(uint32_t idx);
+
+        void _release(uint32_t idx);
+
+        void _cascade(int level, uint64_t index);
+
+        void _fire(uint32_t idx);
+    };
+}  //  namespace wshttp
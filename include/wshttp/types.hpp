@@ -54,9 +54,11 @@ namespace wshttp
             }
 
             std::array<T, N> arr;
-            using size = std::integral_constant<size_t, N>;
 
-            consteval const_span<const T, N> span() const { return {arr}; }
+            // excludes the literal's terminating NUL, so that spans compare and go on the wire as the bare string
+            using size = std::integral_constant<size_t, N - 1>;
+
+            consteval const_span<const T, N - 1> span() const { return const_span<const T, N - 1>{arr.data(), N - 1}; }
         };
 
         template <size_t N>
@@ -127,6 +129,16 @@ namespace wshttp
             inline void operator()(::bufferevent* b) const { bufferevent_free(b); };
         };
 
+        struct _evbuffer
+        {
+            inline void operator()(::evbuffer* b) const { ::evbuffer_free(b); };
+        };
+
+        struct _file_segment
+        {
+            inline void operator()(::evbuffer_file_segment* f) const { ::evbuffer_file_segment_free(f); };
+        };
+
         struct _evconnlistener
         {
             inline void operator()(::evconnlistener* e) const { ::evconnlistener_free(e); };
@@ -142,6 +154,11 @@ namespace wshttp
             inline void operator()(SSL* s) const { SSL_shutdown(s); };
         };
 
+        struct _ssl_session
+        {
+            inline void operator()(SSL_SESSION* s) const { SSL_SESSION_free(s); };
+        };
+
     }  //  namespace deleters
 
     using tcp_listener = std::shared_ptr<evconnlistener>;
@@ -150,11 +167,19 @@ namespace wshttp
 
     using ssl_ptr = std::unique_ptr<::SSL, deleters::_ssl>;
     using ssl_ctx_ptr = std::unique_ptr<::SSL_CTX, deleters::_ssl_ctx>;
+    using ssl_session_ptr = std::unique_ptr<::SSL_SESSION, deleters::_ssl_session>;
 
     using event_ptr = std::unique_ptr<::event, deleters::_event>;
 
+    using loop_ptr = std::shared_ptr<::event_base>;
+
     using bufferevent_ptr = std::unique_ptr<::bufferevent, deleters::_bufferevent>;
 
+    using file_segment_ptr = std::unique_ptr<::evbuffer_file_segment, deleters::_file_segment>;
+
+    // block of session input shared by the body chunks that borrow from it; see `recv_chunk`
+    using input_block_ptr = std::shared_ptr<::evbuffer>;
+
     enum class IO { INBOUND, OUTBOUND };
 
     namespace req
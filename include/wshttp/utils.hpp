@@ -26,6 +26,7 @@ extern "C"
 #include <cstring>
 #include <filesystem>
 #include <functional>
+#include <list>
 #include <memory>
 #include <optional>
 #include <queue>
@@ -2,6 +2,9 @@
 
 #include "internal.hpp"
 
+#include <openssl/core_names.h>
+#include <openssl/rand.h>
+
 namespace wshttp
 {
     int ctx_callbacks::server_select_alpn_proto_cb(
@@ -23,6 +26,214 @@ namespace wshttp
         return SSL_TLSEXT_ERR_OK;
     }
 
+    int ctx_callbacks::client_new_session_cb(SSL* ssl, SSL_SESSION* sess)
+    {
+        log->trace("{} called", __PRETTY_FUNCTION__);
+
+        auto* ctx = static_cast<app_context*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+
+        // returning 1 hands our reference to `sess` over to the cache
+        return ctx and ctx->_client_sessions.store(ssl, sess) ? 1 : 0;
+    }
+
+    int ctx_callbacks::ticket_key_cb(
+        SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cctx, EVP_MAC_CTX* hctx, int enc)
+    {
+        auto* ctx = static_cast<app_context*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+
+        // without keys, no tickets are issued and those presented fall back to a full handshake
+        if (not ctx or not ctx->_ticket_keys)
+            return 0;
+
+        return ctx->_ticket_keys->crypt(name, iv, cctx, hctx, enc);
+    }
+
+    ticket_keys::ticket_keys(std::chrono::seconds interval, size_t retained)
+        : _interval{interval}, _retained{retained}, _keys{std::make_shared<const std::vector<key>>()}
+    {
+        if (_interval <= 0s or _retained < 2)
+            throw std::invalid_argument{
+                "Invalid ticket key rotation (interval: {}s, retained: {})"_format(_interval.count(), _retained)};
+
+        rotate();
+    }
+
+    std::shared_ptr<ticket_keys> ticket_keys::make(std::chrono::seconds interval, size_t retained)
+    {
+        return std::shared_ptr<ticket_keys>{new ticket_keys{interval, retained}};
+    }
+
+    void ticket_keys::rotate()
+    {
+        key k;
+
+        if (RAND_bytes(k.name.data(), k.name.size()) != 1 or RAND_bytes(k.aes.data(), k.aes.size()) != 1
+            or RAND_bytes(k.hmac.data(), k.hmac.size()) != 1)
+            throw std::runtime_error{"Failed to generate session ticket key: {}"_format(detail::current_error())};
+
+        auto prev = _keys.load();
+        std::shared_ptr<const std::vector<key>> next;
+
+        do
+        {
+            auto keys = std::make_shared<std::vector<key>>();
+            keys->reserve(_retained);
+            keys->push_back(k);
+            keys->insert(keys->end(), prev->begin(), prev->begin() + std::min(prev->size(), _retained - 1));
+            next = std::move(keys);
+        } while (not _keys.compare_exchange_weak(prev, next));
+
+        _rotated_at.store(std::chrono::steady_clock::now().time_since_epoch().count());
+        _rotations.fetch_add(1, std::memory_order_relaxed);
+
+        log->debug("Rotated session ticket keys ({} in use)", next->size());
+    }
+
+    bool ticket_keys::rotate_if_due()
+    {
+        auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        auto at = _rotated_at.load();
+
+        // of several endpoints sharing the keys, only the one that claims the due rotation performs it
+        if (std::chrono::steady_clock::duration{now - at} < _interval)
+            return false;
+
+        if (not _rotated_at.compare_exchange_strong(at, now))
+            return false;
+
+        rotate();
+        return true;
+    }
+
+    int ticket_keys::crypt(
+        unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cctx, EVP_MAC_CTX* hctx, int enc) const
+    {
+        auto keys = _keys.load();
+        auto it = keys->begin();
+
+        if (not enc)
+        {
+            it = std::ranges::find_if(*keys, [&](const key& k) { return std::memcmp(k.name.data(), name, 16) == 0; });
+
+            if (it == keys->end())
+                return 0;
+        }
+        else
+        {
+            std::memcpy(name, it->name.data(), it->name.size());
+
+            if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1)
+                return -1;
+        }
+
+        std::array<OSSL_PARAM, 3> params{
+            OSSL_PARAM_construct_octet_string(
+                OSSL_MAC_PARAM_KEY, const_cast<unsigned char*>(it->hmac.data()), it->hmac.size()),
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+            OSSL_PARAM_construct_end()};
+
+        if (EVP_MAC_CTX_set_params(hctx, params.data()) != 1)
+            return -1;
+
+        if (enc)
+            return EVP_EncryptInit_ex(cctx, EVP_aes_256_cbc(), nullptr, it->aes.data(), iv) == 1 ? 1 : -1;
+
+        if (EVP_DecryptInit_ex(cctx, EVP_aes_256_cbc(), nullptr, it->aes.data(), iv) != 1)
+            return -1;
+
+        // always renewed: clients use TLS 1.3 tickets once, and OpenSSL only sends fresh ones on resumption if asked
+        return 2;
+    }
+
+    int tls_session_cache::key_index()
+    {
+        static int index = SSL_get_ex_new_index(
+            0, nullptr, nullptr, nullptr, [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+                delete static_cast<std::string*>(ptr);
+            });
+
+        return index;
+    }
+
+    bool tls_session_cache::resume(SSL* ssl, std::string key)
+    {
+        if (_capacity == 0)
+            return false;
+
+        auto it = _index.find(key);
+
+        SSL_set_ex_data(ssl, key_index(), new std::string{std::move(key)});
+
+        if (it == _index.end())
+            return false;
+
+        auto* sess = it->second->second.get();
+
+        if (not SSL_SESSION_is_resumable(sess)
+            or SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess) <= static_cast<long>(time(nullptr)))
+        {
+            log->debug("Cached TLS session for {} expired", it->first);
+            erase(it->second);
+            return false;
+        }
+
+        if (SSL_set_session(ssl, sess) != 1)
+        {
+            log->warn("Failed to set cached TLS session for {}: {}", it->first, detail::current_error());
+            return false;
+        }
+
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return true;
+    }
+
+    bool tls_session_cache::store(SSL* ssl, SSL_SESSION* sess)
+    {
+        auto* key = static_cast<std::string*>(SSL_get_ex_data(ssl, key_index()));
+
+        if (not key or _capacity == 0 or not SSL_SESSION_is_resumable(sess))
+            return false;
+
+        // the newest session replaces the previous one for the host
+        if (auto it = _index.find(*key); it != _index.end())
+        {
+            it->second->second.reset(sess);
+            _lru.splice(_lru.begin(), _lru, it->second);
+            return true;
+        }
+
+        if (_index.size() >= _capacity)
+            erase(std::prev(_lru.end()));
+
+        _lru.emplace_front(*key, ssl_session_ptr{sess});
+        _index.emplace(_lru.front().first, _lru.begin());
+
+        log->debug("Cached TLS session for {} ({}/{})", *key, _index.size(), _capacity);
+        return true;
+    }
+
+    void tls_session_cache::record(const SSL* ssl)
+    {
+        if (SSL_session_reused(ssl))
+            _hits.fetch_add(1, std::memory_order_relaxed);
+        else
+            _misses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void tls_session_cache::set_capacity(size_t n)
+    {
+        _capacity = n;
+
+        while (_index.size() > _capacity)
+            erase(std::prev(_lru.end()));
+    }
+
+    void tls_session_cache::erase(decltype(_lru)::iterator it)
+    {
+        _index.erase(it->first);
+        _lru.erase(it);
+    }
+
     void app_context::_init()
     {
         if (_creds)
@@ -52,6 +263,8 @@ namespace wshttp
 
         SSL_CTX_set_verify(_i.get(), SSL_VERIFY_PEER, nullptr);
         // SSL_CTX_set_cert_verify_callback(_ctx.get(), nullptr, nullptr);
+
+        _init_server_resumption();
     }
 
     void app_context::_init_inbound(const char* _keyfile, const char* _certfile)
@@ -65,9 +278,11 @@ namespace wshttp
         SSL_CTX_set_options(
             _i.get(),
             SSL_OP_ALL | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION
-                | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION | SSL_OP_SINGLE_ECDH_USE | SSL_OP_NO_TICKET
+                | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION | SSL_OP_SINGLE_ECDH_USE
                 | SSL_OP_CIPHER_SERVER_PREFERENCE);
 
+        _init_server_resumption();
+
         if (SSL_CTX_use_PrivateKey_file(_i.get(), _keyfile, SSL_FILETYPE_PEM) != 1)
             throw std::runtime_error{"Failed to read private key file!"};
 
@@ -91,7 +306,9 @@ namespace wshttp
         SSL_CTX_set_options(
             _o.get(),
             SSL_OP_ALL | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION
-                | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION | SSL_OP_SINGLE_ECDH_USE | SSL_OP_NO_TICKET);
+                | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION | SSL_OP_SINGLE_ECDH_USE);
+
+        _init_client_resumption();
 
         // for client outbounds w/ no keys
         if (SSL_CTX_set_default_verify_paths(_o.get()) != 1)
@@ -112,7 +329,9 @@ namespace wshttp
         SSL_CTX_set_options(
             _o.get(),
             SSL_OP_ALL | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION
-                | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION | SSL_OP_SINGLE_ECDH_USE | SSL_OP_NO_TICKET);
+                | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION | SSL_OP_SINGLE_ECDH_USE);
+
+        _init_client_resumption();
 
         if (SSL_CTX_use_PrivateKey_file(_o.get(), _keyfile, SSL_FILETYPE_PEM) != 1)
             throw std::runtime_error{"Failed to read private key file!"};
@@ -125,4 +344,36 @@ namespace wshttp
 
         SSL_CTX_set_verify(_o.get(), SSL_VERIFY_PEER, nullptr);
     }
+
+    void app_context::_init_server_resumption()
+    {
+        // tickets are only issued once keys are configured; see `configure_server_resumption`
+        SSL_CTX_set_app_data(_i.get(), this);
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(_i.get(), ctx_callbacks::ticket_key_cb);
+        SSL_CTX_set_session_cache_mode(_i.get(), SSL_SESS_CACHE_OFF);
+
+        // server-side sessions are only resumed within the same context id
+        static constexpr auto sid_ctx = "wshttp"sv;
+        SSL_CTX_set_session_id_context(
+            _i.get(), reinterpret_cast<const unsigned char*>(sid_ctx.data()), sid_ctx.size());
+    }
+
+    void app_context::configure_server_resumption(std::shared_ptr<ticket_keys> keys, size_t server_sessions)
+    {
+        if (keys)
+            SSL_CTX_set_timeout(_i.get(), keys->ticket_lifetime().count());
+
+        _ticket_keys = std::move(keys);
+
+        SSL_CTX_set_session_cache_mode(_i.get(), server_sessions ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+        SSL_CTX_sess_set_cache_size(_i.get(), static_cast<long>(server_sessions));
+    }
+
+    void app_context::_init_client_resumption()
+    {
+        // OpenSSL's own client cache is never looked up by host, so sessions only go to ours (see `tls_session_cache`)
+        SSL_CTX_set_app_data(_o.get(), this);
+        SSL_CTX_set_session_cache_mode(_o.get(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(_o.get(), ctx_callbacks::client_new_session_cb);
+    }
 }  //  namespace wshttp
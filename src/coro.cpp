@@ -0,0 +1,125 @@
+#include "coro.hpp"
+
+#include "internal.hpp"
+#include "loop.hpp"
+
+namespace wshttp
+{
+    thread_local frame_pool* frame_pool::_current{nullptr};
+
+    frame_pool::~frame_pool()
+    {
+        size_t n{0};
+
+        for (auto& list : _free)
+        {
+            n += list.size();
+            for (auto* p : list)
+                ::operator delete(p);
+        }
+
+        log->trace("Coroutine frame pool released {} cached frames", n);
+    }
+
+    void* frame_pool::allocate(size_t n)
+    {
+        auto cls = (n + GRANULE - 1) / GRANULE;
+        auto* pool = cls <= NUM_CLASSES ? _current : nullptr;
+        void* p{nullptr};
+
+        if (pool)
+        {
+            if (auto& list = pool->_free[cls - 1]; not list.empty())
+            {
+                p = list.back();
+                list.pop_back();
+            }
+            else
+                p = ::operator new(sizeof(header) + cls * GRANULE);
+        }
+        else
+            p = ::operator new(sizeof(header) + n);
+
+        static_cast<header*>(p)->owner = pool;
+        return static_cast<std::byte*>(p) + sizeof(header);
+    }
+
+    void frame_pool::deallocate(void* ptr, size_t n) noexcept
+    {
+        auto* p = static_cast<std::byte*>(ptr) - sizeof(header);
+        auto* pool = reinterpret_cast<header*>(p)->owner;
+
+        if (pool and pool == _current)
+        {
+            if (auto& list = pool->_free[(n + GRANULE - 1) / GRANULE - 1]; list.size() < MAX_CACHED)
+            {
+                try
+                {
+                    list.push_back(p);
+                    return;
+                }
+                catch (...)
+                {}
+            }
+        }
+
+        ::operator delete(p);
+    }
+
+    namespace detail
+    {
+        void report_detached(std::exception_ptr err) noexcept
+        {
+            try
+            {
+                std::rethrow_exception(err);
+            }
+            catch (const std::exception& e)
+            {
+                log->critical("Detached task terminated with exception: {}", e.what());
+            }
+            catch (...)
+            {
+                log->critical("Detached task terminated with unknown exception");
+            }
+        }
+
+        void resume_soon(event_loop& loop, std::coroutine_handle<> h)
+        {
+            loop.call_soon([h]() { h.resume(); });
+        }
+
+        pending_resume resume_cancellable(event_loop& loop, std::coroutine_handle<> h)
+        {
+            auto p = std::make_shared<std::coroutine_handle<>>(h);
+
+            loop.call_soon([p]() {
+                if (auto h = std::exchange(*p, nullptr))
+                    h.resume();
+            });
+
+            return p;
+        }
+    }  //  namespace detail
+
+    void sleep_awaiter::await_suspend(std::coroutine_handle<> h)
+    {
+        auto target_time = detail::get_time() + _delay;
+        auto& wheel = _loop.timers(_res);
+
+        // the handle is in place before the timer can fire and resume `h`, which may free this awaiter along with it
+        _timer = wheel.reserve([h]() { h.resume(); });
+
+        _loop.call([&wheel, t = _timer, target_time]() { wheel._schedule(t, target_time); });
+    }
+
+    bool resume_on_awaiter::await_ready() const noexcept
+    {
+        return _loop.in_event_loop();
+    }
+
+    void resume_on_awaiter::await_suspend(std::coroutine_handle<> h)
+    {
+        detail::resume_soon(_loop, h);
+    }
+}  //  namespace wshttp
@@ -3,6 +3,7 @@
 // #include "dns.hpp"
 #include "internal.hpp"
 #include "request.hpp"
+#include "session.hpp"
 
 namespace wshttp
 {
@@ -17,6 +18,8 @@ namespace wshttp
         if (not _close_immediately)
             shutdown_endpoint();
 
+        for (auto& [_, ls] : _listeners)
+            drop_listeners(ls);
         _listeners.clear();
 
         // clear all mappings here
@@ -28,6 +31,36 @@ namespace wshttp
         log->info("Client shutdown complete!");
     }
 
+    async_latch<bool>::awaiter endpoint::connected(std::string_view host)
+    {
+        assert(in_event_loop());
+
+        if (auto n = _nodes.find(std::string{host}); n != _nodes.end())
+        {
+            if (auto s = n->second->acquire_session())
+                return s->connected();
+        }
+
+        log->warn("No outbound session to host {} to await!", host);
+        return async_latch<bool>::ready(false);
+    }
+
+    std::shared_ptr<stream> endpoint::submit(std::string_view host, request req, response_handler handler)
+    {
+        return call_get([&]() -> std::shared_ptr<stream> {
+            auto n = _nodes.find(std::string{host});
+
+            if (n == _nodes.end())
+            {
+                log->warn("No outbound node to host {} to submit request to!", host);
+                return nullptr;
+            }
+
+            auto s = n->second->acquire_session();
+            return s ? s->submit(std::move(req), std::move(handler)) : nullptr;
+        });
+    }
+
     void endpoint::test_parse_method(std::string url)
     {
         log->debug("{} called", __PRETTY_FUNCTION__);
@@ -40,33 +73,160 @@ namespace wshttp
         });
     }
 
+    bool endpoint::listen(uint16_t port)
+    {
+        // an ephemeral port is resolved by the primary's bind, and every other shard joins it there
+        auto bound = call_get([&]() {
+            auto [itr, b] = _listeners.try_emplace(port);
+
+            if (not b)
+                throw std::invalid_argument{
+                    "Cannot create tcp-listener at port {} -- listener already exists!"_format(port)};
+
+            // checked several times per interval, so that keys shared with other endpoints rotate close to on time
+            if (_resumption.keys and not _ticket_rotation)
+                _ticket_rotation = call_every(
+                    std::max<std::chrono::microseconds>(_resumption.keys->interval() / 8, 1s),
+                    [keys = _resumption.keys]() { keys->rotate_if_due(); },
+                    timer_res::coarse);
+
+            try
+            {
+                itr->second.push_back(make_shared<listener>(*this, *_loop, port, _pool != nullptr));
+            }
+            catch (...)
+            {
+                _listeners.erase(itr);
+                throw;
+            }
+
+            return itr->second.front()->_local.port();
+        });
+
+        if (not _pool)
+            return true;
+
+        // every other shard binds on its own loop, all at once, without the primary waiting on each in turn
+        std::vector<std::future<std::shared_ptr<listener>>> pending;
+
+        for (size_t i = 1; i < _pool->size(); ++i)
+        {
+            auto* l = (*_pool)[i].get();
+            pending.push_back(l->call_async(
+                [this, l, bound]() { return l->template make_shared<listener>(*this, *l, bound, true); }));
+        }
+
+        std::vector<std::shared_ptr<listener>> shards;
+        std::exception_ptr err;
+
+        for (auto& f : pending)
+        {
+            try
+            {
+                shards.push_back(f.get());
+            }
+            catch (...)
+            {
+                err = std::current_exception();
+            }
+        }
+
+        auto ls = call_get([&]() {
+            auto it = _listeners.find(port);
+
+            if (err or it == _listeners.end())
+            {
+                auto dropped = std::move(shards);
+
+                if (it != _listeners.end())
+                {
+                    std::ranges::move(it->second, std::back_inserter(dropped));
+                    _listeners.erase(it);
+                }
+
+                return dropped;
+            }
+
+            std::ranges::move(shards, std::back_inserter(it->second));
+            return std::vector<std::shared_ptr<listener>>{};
+        });
+
+        if (not ls.empty() or err)
+        {
+            drop_listeners(ls);
+
+            if (err)
+                std::rethrow_exception(err);
+
+            log->warn("Endpoint listener (port: {}) was closed while sharding", port);
+            return false;
+        }
+
+        log->info("Endpoint sharded listener (port: {}) across {} event loops", port, _pool->size());
+        return true;
+    }
+
+    void endpoint::drop_listeners(std::vector<std::shared_ptr<listener>>& ls)
+    {
+        // each goes down on its own loop, all of them at once
+        std::vector<std::future<void>> done;
+
+        for (auto& l : ls)
+        {
+            auto& loop = l->_loop;
+            done.push_back(loop.call_async([l = std::move(l)]() mutable { l.reset(); }));
+        }
+
+        for (auto& f : done)
+            f.get();
+
+        ls.clear();
+    }
+
     void endpoint::close_listener(uint16_t p)
     {
-        return _loop->call_get([&]() {
-            if (_listeners.erase(p))
+        auto ls = _loop->call_get([&]() {
+            std::vector<std::shared_ptr<listener>> ls;
+
+            if (auto it = _listeners.find(p); it != _listeners.end())
             {
-                log->info("Endpoint closed listener on port: {}", p);
+                ls = std::move(it->second);
+                _listeners.erase(it);
             }
             else
                 log->warn("Endpoint failed to find listener (port: {}) to close!", p);
+
+            return ls;
         });
+
+        if (ls.empty())
+            return;
+
+        drop_listeners(ls);
+        log->info("Endpoint closed listener on port: {}", p);
     }
 
     void endpoint::shutdown_endpoint()
     {
         log->debug("{} called...", __PRETTY_FUNCTION__);
 
-        std::promise<void> p;
-        auto f = p.get_future();
-
-        _loop->call([&]() {
-            // clear all mappings here
-            for (auto& [_, l] : _listeners)
-                l->close_all();
-            p.set_value();
+        auto ls = _loop->call_get([&]() {
+            std::vector<std::shared_ptr<listener>> ls;
+            for (auto& [_, shards] : _listeners)
+                ls.insert(ls.end(), shards.begin(), shards.end());
+            return ls;
         });
 
-        f.get();
+        // every listener closes its sessions on its own loop, all at once
+        std::vector<std::future<void>> done;
+
+        for (auto& l : ls)
+            done.push_back(l->_loop.call_async([l]() { l->close_all(); }));
+
+        ls.clear();
+
+        for (auto& f : done)
+            f.get();
     }
 
     SSL_CTX* endpoint::inbound_ctx()
@@ -83,5 +243,112 @@ namespace wshttp
     {
         log->info("New endpoint configured with SSL credentials");
         _ctx = app_context::make(std::move(c));
+        apply_resumption();
+    }
+
+    void endpoint::handle_ep_opt(write_watermarks w)
+    {
+        if (w.low > w.high or w.high == 0 or (w.adaptive and w.max < w.high))
+            throw std::invalid_argument{
+                "Invalid write watermarks (low: {}, high: {}, max: {})"_format(w.low, w.high, w.max)};
+
+        log->info(
+            "New endpoint configured with {}write watermarks (low: {}, high: {})",
+            w.adaptive ? "adaptive " : "",
+            w.low,
+            w.high);
+        _watermarks = w;
+    }
+
+    void endpoint::handle_ep_opt(tls_mode m)
+    {
+#ifndef SSL_OP_ENABLE_KTLS
+        if (m == tls_mode::kernel)
+        {
+            log->warn("Kernel TLS requested, but OpenSSL was built without it; using userspace TLS");
+            return;
+        }
+#endif
+        log->info("New endpoint configured with {} TLS", m == tls_mode::kernel ? "kernel" : "userspace");
+        _tls_mode = m;
+    }
+
+    void endpoint::handle_ep_opt(tls_resumption r)
+    {
+        log->info(
+            "New endpoint configured with {} cached outbound and {} cached inbound TLS sessions, {} ticket keys",
+            r.client_sessions,
+            r.server_sessions,
+            r.keys ? "shared" : "own");
+
+        if (not r.keys)
+            r.keys = std::move(_resumption.keys);
+        _resumption = std::move(r);
+
+        // the context may not have been made yet; if not, it picks these up once it is
+        if (_ctx)
+            apply_resumption();
+    }
+
+    void endpoint::apply_resumption()
+    {
+        if (not _resumption.keys)
+            _resumption.keys = ticket_keys::make();
+
+        _ctx->client_sessions().set_capacity(_resumption.client_sessions);
+        _ctx->configure_server_resumption(_resumption.keys, _resumption.server_sessions);
+    }
+
+    static void validate_h2_settings(const h2_settings& s, std::string_view dir)
+    {
+        auto fail = [&](std::string_view what, uint32_t v) {
+            throw std::invalid_argument{"Invalid {} HTTP/2 {}: {}"_format(dir, what, v)};
+        };
+
+        if (s.initial_window_size and *s.initial_window_size > NGHTTP2_MAX_WINDOW_SIZE)
+            fail("initial window size", *s.initial_window_size);
+        if (s.connection_window_size and *s.connection_window_size > NGHTTP2_MAX_WINDOW_SIZE)
+            fail("connection window size", *s.connection_window_size);
+        if (s.max_frame_size and (*s.max_frame_size < (1 << 14) or *s.max_frame_size > (1 << 24) - 1))
+            fail("max frame size", *s.max_frame_size);
+    }
+
+    void endpoint::handle_ep_opt(h2_profile p)
+    {
+        validate_h2_settings(p.inbound, "inbound");
+        validate_h2_settings(p.outbound, "outbound");
+
+        log->info("New endpoint configured with custom HTTP/2 settings");
+        _h2 = std::move(p);
+    }
+
+    void endpoint::handle_ep_opt(loop_mode m)
+    {
+        // the event base is made with or without locks before the endpoint exists; see `endpoint::make`. Builds without
+        // the eventfd waker make every loop threadsafe, so a single-threaded one is never on offer
+        if (m == loop_mode::single_threaded and not event_loop::supports_lock_free())
+        {
+            log->warn("Single-threaded event loops are unsupported in this build; endpoint falling back to threadsafe");
+            return;
+        }
+
+        if (m != _loop->mode())
+            throw std::invalid_argument{"Endpoint requested a {} event loop, but was given a {} one"_format(
+                m == loop_mode::single_threaded ? "single-threaded" : "threadsafe",
+                _loop->lock_free() ? "single-threaded" : "threadsafe")};
+
+        log->info("New endpoint configured with {} event loop", _loop->lock_free() ? "single-threaded" : "threadsafe");
+    }
+
+    void endpoint::configure_ssl(SSL* ssl) const
+    {
+#ifdef SSL_OP_ENABLE_KTLS
+        // Has to be set before the handshake; OpenSSL only engages kTLS once it completes, and silently stays in
+        // userspace if the kernel or the negotiated cipher cannot do it
+        if (_tls_mode == tls_mode::kernel)
+            SSL_set_options(ssl, SSL_OP_ENABLE_KTLS);
+#else
+        (void)ssl;
+#endif
     }
 }  //  namespace wshttp
@@ -15,6 +15,9 @@ namespace wshttp
 
     static constexpr auto https_proto = "https"sv;
 
+    // streams an outbound session assumes it may open before the peer's SETTINGS arrive; the RFC 9113 recommended floor
+    static constexpr uint32_t DEFAULT_PEER_MAX_STREAMS{100};
+
     struct uri;
 
     class url_parser
@@ -95,10 +98,23 @@ namespace wshttp
         }
     }  // namespace detail
 
+    timeval loop_time_to_timeval(std::chrono::microseconds t);
+
+    class event_loop;
+
+    // Scope guard timing a libevent callback into its loop's `callback` histogram; also marks the loop iteration busy
+    struct callback_probe
+    {
+        event_loop& _loop;
+        std::chrono::steady_clock::time_point _start;
+
+        explicit callback_probe(event_loop& l);
+        ~callback_probe();
+    };
+
     struct loop_callbacks
     {
-        static void exec_oneshot(evutil_socket_t fd, short, void* user_arg);
-        static void exec_iterative(evutil_socket_t fd, short, void* user_arg);
+        static void timer_tick(evutil_socket_t fd, short, void* user_arg);
     };
 
     struct ctx_callbacks
@@ -110,6 +126,16 @@ namespace wshttp
             const unsigned char* in,
             unsigned int inlen,
             void* arg);
+
+        static int client_new_session_cb(SSL* ssl, SSL_SESSION* sess);
+
+        static int ticket_key_cb(
+            SSL* ssl,
+            unsigned char* name,
+            unsigned char* iv,
+            EVP_CIPHER_CTX* cctx,
+            EVP_MAC_CTX* hctx,
+            int enc);
     };
 
     struct dns_callbacks
@@ -122,6 +148,7 @@ namespace wshttp
         static void accept_cb(
             struct evconnlistener* evconn, evutil_socket_t fd, struct sockaddr* addr, int addrlen, void* user_arg);
         static void error_cb(struct evconnlistener* evconn, void* user_arg);
+        static void uring_accept_cb(int res, uint32_t flags, void* user_arg);
     };
 
     struct session_callbacks
@@ -130,9 +157,8 @@ namespace wshttp
         static void event_cb(struct bufferevent* bev, short events, void* user_arg);
         static void read_cb(struct bufferevent* bev, void* user_arg);
         static void write_cb(struct bufferevent* bev, void* user_arg);
+        static void writable_cb(evutil_socket_t fd, short events, void* user_arg);
 
-        static nghttp2_ssize send_callback(
-            nghttp2_session* session, const uint8_t* data, size_t length, int flags, void* user_arg);
         static int on_frame_send_callback(nghttp2_session* session, const nghttp2_frame* frame, void* user_data);
         static int on_data_chunk_recv_callback(
             nghttp2_session* session,
@@ -154,6 +180,21 @@ namespace wshttp
             uint8_t flags,
             void* user_arg);
         static int on_begin_headers_callback(nghttp2_session* session, const nghttp2_frame* frame, void* user_arg);
+        static nghttp2_ssize data_source_read_length_callback(
+            nghttp2_session* session,
+            uint8_t frame_type,
+            int32_t stream_id,
+            int32_t session_remote_window_size,
+            int32_t stream_remote_window_size,
+            uint32_t remote_max_frame_size,
+            void* user_arg);
+        static int send_data_callback(
+            nghttp2_session* session,
+            nghttp2_frame* frame,
+            const uint8_t* framehd,
+            size_t length,
+            nghttp2_data_source* source,
+            void* user_arg);
     };
 
     struct stream_callbacks
@@ -166,6 +207,22 @@ namespace wshttp
             uint32_t* data_flags,
             nghttp2_data_source* source,
             void* user_data);
+        static nghttp2_ssize file_segment_read_callback(
+            nghttp2_session* session,
+            int32_t stream_id,
+            uint8_t* buf,
+            size_t length,
+            uint32_t* data_flags,
+            nghttp2_data_source* source,
+            void* user_data);
+        static nghttp2_ssize body_read_callback(
+            nghttp2_session* session,
+            int32_t stream_id,
+            uint8_t* buf,
+            size_t length,
+            uint32_t* data_flags,
+            nghttp2_data_source* source,
+            void* user_data);
     };
 
     struct buffer_printer
@@ -3,6 +3,7 @@
 #include "endpoint.hpp"
 #include "internal.hpp"
 #include "session.hpp"
+#include "uring.hpp"
 
 namespace wshttp
 {
@@ -14,6 +15,7 @@ namespace wshttp
         void* user_arg)
     {
         auto& l = *static_cast<listener*>(user_arg);
+        callback_probe probe{l._loop};
         auto remote = ip_address{addr};
         l.create_inbound_session(std::move(remote), fd);
     }
@@ -25,16 +27,73 @@ namespace wshttp
         return l.close_listener();
     }
 
+    void listen_callbacks::uring_accept_cb(int res, uint32_t flags, void* user_arg)
+    {
+#ifdef WSHTTP_USE_IO_URING
+        auto& l = *static_cast<listener*>(user_arg);
+
+        if (res >= 0)
+        {
+            sockaddr_storage addr{};
+            socklen_t len = sizeof(addr);
+
+            if (getpeername(res, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+            {
+                log->warn("Failed to get remote address of accepted connection: {}", strerror(errno));
+                close(res);
+            }
+            else
+                l.create_inbound_session(ip_address{reinterpret_cast<sockaddr*>(&addr)}, res);
+        }
+        else
+            log->warn("io_uring accept on listener (port: {}) failed: {}", l._local.port(), strerror(-res));
+
+        if (not(flags & IORING_CQE_F_MORE))
+        {
+            l._accept_op = 0;
+
+            // the kernel ends a multishot accept on errors and resource limits; anything but a broken socket re-arms
+            if (res == -EBADF or res == -EINVAL or res == -ENOTSOCK)
+                return l.close_listener();
+
+            // re-arming straight away would fail again at once and spin the loop until a descriptor frees up
+            if (res == -EMFILE or res == -ENFILE or res == -ENOMEM)
+            {
+                l._accept_retry = l._loop.call_later(
+                    ACCEPT_RETRY_DELAY, [&l]() { l._arm_accept(); }, timer_res::coarse);
+                return;
+            }
+
+            l._arm_accept();
+        }
+#else
+        (void)res, (void)flags, (void)user_arg;
+#endif
+    }
+
     listener::~listener()
     {
+#ifdef WSHTTP_USE_IO_URING
+        _accept_retry.cancel();
+
+        if (auto* ring = _loop.ring(); ring and _fd >= 0)
+        {
+            if (_accept_op)
+            {
+                ring->cancel(_accept_op);
+                ring->submit();
+            }
+            close(_fd);
+        }
+#endif
         log->debug("Closing listener on port: {}", _local.port());
     }
 
     void listener::create_inbound_session(ip_address remote, evutil_socket_t fd)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->info("Inbound connection established (remote: {})", remote);
-        _ep.call_get([&]() {
+        _loop.call_get([&]() {
             auto [it, b] = _sessions.emplace(remote, nullptr);
 
             if (not b)
@@ -44,7 +103,7 @@ namespace wshttp
                 return;
             }
 
-            it->second = _ep.template make_shared<inbound_session>(*this, std::move(remote), fd);
+            it->second = _loop.template make_shared<inbound_session>(*this, std::move(remote), fd);
 
             if (not it->second)
             {
@@ -56,8 +115,7 @@ namespace wshttp
 
     void listener::close_all()
     {
-        assert(_ep.in_event_loop());
-        _ep.call([&]() {
+        _loop.call_get([&]() {
             log->info("listener (port:{}) closing all sessions...", _local.port());
             _sessions.clear();
         });
@@ -65,14 +123,14 @@ namespace wshttp
 
     void listener::close_listener()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         _ep.call_soon([&]() { _ep.close_listener(_local.port()); });
     }
 
     void listener::close_session(ip_address remote)
     {
-        assert(_ep.in_event_loop());
-        _ep.call([&]() {
+        assert(_loop.in_event_loop());
+        _loop.call([&]() {
             if (_sessions.erase(remote))
                 log->info("Listener closed session to remote: {}", remote);
             else
@@ -82,20 +140,40 @@ namespace wshttp
 
     void listener::_init_internals()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         sockaddr_in addr{};
         addr.sin_family = AF_INET;
         addr.sin_addr.s_addr = INADDR_ANY;
         addr.sin_port = enc::host_to_big(_local.port());
 
-        _tcp = _ep.template shared_ptr<struct evconnlistener>(
+        if (_loop.ring())
+            _listen_uring(addr);
+        else
+            _listen_evconn(addr);
+
+        sockaddr _laddr{};
+        socklen_t len = sizeof(_laddr);
+
+        if (getsockname(_fd, &_laddr, &len) < 0)
+            throw std::runtime_error{"Failed to get local socket address for tcp listener on port {}: {}"_format(
+                _local.port(), detail::current_error())};
+
+        _local = ip_address{&_laddr};
+
+        log->info("TCP listener deployed on local bind: {}", _local);
+    }
+
+    void listener::_listen_evconn(const sockaddr_in& addr)
+    {
+        _tcp = _loop.template shared_ptr<struct evconnlistener>(
             evconnlistener_new_bind(
-                _ep._loop->loop().get(),
+                _loop.loop().get(),
                 listen_callbacks::accept_cb,
                 this,
-                LEV_OPT_CLOSE_ON_FREE | LEV_OPT_THREADSAFE | LEV_OPT_REUSEABLE,
+                LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE | (_reuse_port ? LEV_OPT_REUSEABLE_PORT : 0)
+                    | (_loop.lock_free() ? 0 : LEV_OPT_THREADSAFE),
                 -1,
-                reinterpret_cast<sockaddr*>(&addr),
+                reinterpret_cast<const sockaddr*>(&addr),
                 sizeof(sockaddr)),
             deleters::_evconnlistener{});
 
@@ -109,28 +187,50 @@ namespace wshttp
 
         _fd = evconnlistener_get_fd(_tcp.get());
         log->debug("TCP listener has fd: {}", _fd);
+    }
 
-        sockaddr _laddr{};
-        socklen_t len;
+    void listener::_listen_uring(const sockaddr_in& addr)
+    {
+        if (_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0); _fd < 0)
+            throw std::runtime_error{"Failed to create tcp listener socket: {}"_format(strerror(errno))};
 
-        if (getsockname(_fd, &_laddr, &len) < 0)
-            throw std::runtime_error{"Failed to get local socket address for tcp listener on port {}: {}"_format(
-                _local.port(), detail::current_error())};
+        int on = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
 
-        _local = ip_address{&_laddr};
+        if (_reuse_port)
+            setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
 
-        log->info("TCP listener deployed on local bind: {}", _local);
+        if (bind(_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 or listen(_fd, SOMAXCONN) < 0)
+        {
+            auto err = strerror(errno);
+            close(_fd);
+            _fd = -1;
+            throw std::runtime_error{"TCP listener failed to bind port {}: {}"_format(_local.port(), err)};
+        }
+
+        _arm_accept();
+        log->debug("TCP listener has fd: {}; accepting through io_uring", _fd);
+    }
+
+    void listener::_arm_accept()
+    {
+#ifdef WSHTTP_USE_IO_URING
+        assert(_loop.in_event_loop());
+        _accept_op = _loop.ring()->accept_multishot(_fd, listen_callbacks::uring_accept_cb, this);
+#endif
     }
 
     SSL* listener::new_ssl()
     {
-        assert(_ep.in_event_loop());
-        return _ep.call_get([&]() {
+        assert(_loop.in_event_loop());
+        return _loop.call_get([&]() {
             SSL* _ssl = SSL_new(_ep.inbound_ctx());
 
             if (!_ssl)
                 throw std::runtime_error{"Failed to create SSL/TLS: {}"_format(detail::current_error())};
 
+            _ep.configure_ssl(_ssl);
+
             log->trace("Created SSL/TLS...");
 
             return _ssl;
@@ -1,6 +1,17 @@
 #include "loop.hpp"
 
 #include "internal.hpp"
+#include "session.hpp"
+#include "uring.hpp"
+
+#ifdef WSHTTP_USE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace wshttp
 {
@@ -44,134 +55,151 @@ namespace wshttp
             .tv_usec = static_cast<decltype(timeval::tv_usec)>((t % 1s) / 1us)};
     }
 
-    void loop_callbacks::exec_iterative(int /* fd */, short /* what */, void* user_arg)
+    ticker_id ticker_registry::add(caller_id_t owner, ev_watcher* w)
     {
-        try
+        uint32_t idx;
+
+        if (_free.empty())
         {
-            auto* self = reinterpret_cast<ev_watcher*>(user_arg);
-            if (not self->f)
-            {
-                log->critical("Ticker does not have a callback to execute!");
-                return;
-            }
-            if (not self->is_running())
-            {
-                log->critical("Ticker attempting to execute finished event!");
-                return;
-            }
-            // execute callback
-            self->fire();
+            idx = static_cast<uint32_t>(_slab.size());
+            _slab.emplace_back();
         }
-        catch (const std::exception& e)
+        else
         {
-            log->critical("EventTicker caught exception: {}", e.what());
+            idx = _free.back();
+            _free.pop_back();
         }
+
+        auto& e = _slab[idx];
+        e.w = w;
+        e.owner = owner;
+        e.prev = NIL;
+
+        auto [it, _] = _heads.try_emplace(owner, NIL);
+        e.next = it->second;
+        if (e.next != NIL)
+            _slab[e.next].prev = idx;
+        it->second = idx;
+
+        return ticker_id{idx, e.gen};
     }
 
-    void loop_callbacks::exec_oneshot(int /* fd */, short /* what */, void* user_arg)
+    void ticker_registry::remove(ticker_id id)
     {
-        try
-        {
-            auto* self = reinterpret_cast<ev_watcher*>(user_arg);
-            if (not self->f)
-            {
-                log->critical("Ticker does not have a callback to execute!");
-                return;
-            }
-            // execute callback
-            self->f();
-        }
-        catch (const std::exception& e)
-        {
-            log->critical("Ticker caught exception: {}", e.what());
-        }
+        if (id.index >= _slab.size() or _slab[id.index].gen != id.gen or not _slab[id.index].w)
+            return;
+
+        auto& e = _slab[id.index];
+
+        if (e.next != NIL)
+            _slab[e.next].prev = e.prev;
+
+        if (e.prev != NIL)
+            _slab[e.prev].next = e.next;
+        else if (e.next != NIL)
+            _heads[e.owner] = e.next;
+        else
+            _heads.erase(e.owner);
+
+        _reset(id.index);
     }
 
-    bool ev_watcher::start()
+    void ticker_registry::_reset(uint32_t idx)
     {
-        if (_is_running)
-            return false;
+        auto& e = _slab[idx];
+        e.w = nullptr;
+        e.prev = e.next = NIL;
+        ++e.gen;
+        _free.push_back(idx);
+    }
 
-        if (event_add(ev.get(), &interval) != 0)
-        {
-            log->critical("EventHandler failed to start repeating event!");
-            return false;
-        }
+    static void pin_thread(uint32_t core)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+
+        if (auto rv = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); rv != 0)
+            log->warn("Failed to pin event loop thread to core {}: {}", core, strerror(rv));
+        else
+            log->debug("Event loop thread pinned to core {}", core);
+#else
+        log->debug("Thread pinning unsupported on this platform; event loop (core: {}) runs unpinned", core);
+#endif
+    }
 
-        _is_running = true;
+    bool ev_watcher::start()
+    {
+        if (_is_running.exchange(true))
+            return false;
 
+        _request_sync();
         return true;
     }
 
     bool ev_watcher::stop()
     {
-        if (not _is_running)
+        if (not _is_running.exchange(false))
             return false;
 
-        if (event_del(ev.get()) != 0)
-        {
-            log->critical("EventHandler failed to pause repeating event!");
-            return false;
-        }
-
-        _is_running = false;
-
+        _request_sync();
         return true;
     }
 
-    void ev_watcher::fire()
+    void ev_watcher::_request_sync()
     {
-        f();
-        event_del(ev.get());
-        event_add(ev.get(), &interval);
+        // the watcher may be released before the loop gets to it; once it is, there is no timer left to sync
+        _loop.call([w = weak_from_this()]() {
+            if (auto self = w.lock())
+                self->_sync();
+        });
     }
 
-    void ev_watcher::init_event(
-        const loop_ptr& _loop,
-        std::chrono::microseconds _t,
-        std::function<void()> task,
-        bool one_off,
-        bool start_immediately,
-        bool fixed_interval)
-    {
-        f = (one_off or not fixed_interval) ? std::move(task) : [this, func = std::move(task)]() mutable {
-            func();
-            event_del(ev.get());
-            event_add(ev.get(), &interval);
-        };
-
-        interval = loop_time_to_timeval(_t);
-
-        ev.reset(event_new(
-            _loop.get(),
-            -1,
-            0,
-            [](evutil_socket_t, short, void* s) {
-                try
-                {
-                    auto* self = reinterpret_cast<ev_watcher*>(s);
-                    if (not self->f)
-                    {
-                        log->critical("Ticker does not have a callback to execute!");
-                        return;
-                    }
-                    // execute callback
-                    self->f();
-                }
-                catch (const std::exception& e)
+    void ev_watcher::_sync()
+    {
+        assert(_loop.in_event_loop());
+
+        // start/stop requests from several threads may arrive in any order; only the latest requested state counts
+        if (_is_running == _timer.pending())
+            return;
+
+        if (not _is_running)
+        {
+            if (not _timer.cancel())
+                log->debug("EventHandler repeating event was no longer scheduled");
+            return;
+        }
+
+        _timer = _loop.timers(res)._schedule(
+            detail::get_time() + interval,
+            [this]() {
+                if (not f)
                 {
-                    log->critical("Ticker caught exception: {}", e.what());
+                    log->critical("Ticker does not have a callback to execute!");
+                    return;
                 }
+                // execute callback
+                f();
             },
-            this));
+            interval,
+            wait);
+    }
 
-        if ((one_off or start_immediately) and not start())
-            log->critical("Failed to immediately start one-off event!");
+    void ev_watcher::init_event(
+        std::chrono::microseconds _t, Job task, bool start_immediately, bool fixed_interval, timer_res _res)
+    {
+        f = std::move(task);
+        interval = _t;
+        wait = fixed_interval;
+        res = _res;
+        _is_running = start_immediately;
     }
 
     ev_watcher::~ev_watcher()
     {
-        ev.reset();
+        _loop.tickers.remove(_id);
+        _timer.cancel();
         f = nullptr;
     }
 
@@ -183,12 +211,23 @@ namespace wshttp
         return ev_methods_avail;
     }
 
-    std::shared_ptr<event_loop> event_loop::make()
+    std::shared_ptr<event_loop> event_loop::make(
+        std::optional<uint32_t> core, std::optional<busy_poll_config> busy_poll, loop_mode mode)
     {
-        return std::shared_ptr<event_loop>{new event_loop{}};
+        return std::shared_ptr<event_loop>{new event_loop{core, busy_poll, mode}};
     }
 
-    event_loop::event_loop()
+    bool event_loop::supports_lock_free()
+    {
+#ifdef WSHTTP_USE_EVENTFD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    event_loop::event_loop(std::optional<uint32_t> core, std::optional<busy_poll_config> busy_poll, loop_mode mode)
+        : poll_config{busy_poll}, _mode{mode}
     {
         log->trace("Beginning loop context creation with new ev loop thread");
 
@@ -226,18 +265,63 @@ namespace wshttp
         event_config_set_flag(ev_conf.get(), EVENT_BASE_FLAG_NO_CACHE_TIME);
         event_config_set_flag(ev_conf.get(), EVENT_BASE_FLAG_EPOLL_USE_CHANGELIST);
 
+        // without the eventfd waker, other threads wake the loop through `event_active`, which needs the base's lock
+        if (lock_free() and not supports_lock_free())
+        {
+            log->warn("Single-threaded event loop requires the eventfd job waker; keeping libevent locking");
+            _mode = loop_mode::threadsafe;
+        }
+
+        if (lock_free())
+            event_config_set_flag(ev_conf.get(), EVENT_BASE_FLAG_NOLOCK);
+
         ev_loop = std::shared_ptr<event_base>{event_base_new_with_config(ev_conf.get()), event_base_free};
 
-        log->debug("Started libevent loop with backend {}", event_base_get_method(ev_loop.get()));
+        log->debug(
+            "Started {}libevent loop with backend {}",
+            lock_free() ? "lock-free " : "",
+            event_base_get_method(ev_loop.get()));
 
         setup_job_waker();
 
+        flush_ev.reset(event_new(
+            ev_loop.get(),
+            -1,
+            0,
+            [](evutil_socket_t, short, void* self) { static_cast<event_loop*>(self)->flush_dirty(); },
+            this));
+
+#ifdef WSHTTP_USE_IO_URING
+        if (uring = io_ring::make(*this); uring)
+            log->info("Event loop accepting connections through io_uring");
+        else
+            log->warn("io_uring unavailable; event loop falling back to {}", event_base_get_method(ev_loop.get()));
+#endif
+
+        fine_timers = timer_wheel::make(*this, ev_loop, FINE_TIMER_TICK);
+        coarse_timers = timer_wheel::make(*this, ev_loop, COARSE_TIMER_TICK);
+
+        if (poll_config)
+        {
+            if (poll_config->max_spin < poll_config->min_spin)
+                throw std::invalid_argument{"Busy poll max_spin must not be less than min_spin"};
+
+            spin_window = poll_config->max_spin;
+
+            if (not core)
+                log->warn("Busy polling event loop is not pinned to a core; its spinning competes with other threads");
+        }
+
         std::promise<void> p;
 
-        loop_thread.emplace([this, &p]() mutable {
+        loop_thread.emplace([this, &p, core]() mutable {
             log->debug("Starting event loop run");
+            if (core)
+                pin_thread(*core);
+            frames.bind();
             p.set_value();
-            event_base_loop(ev_loop.get(), EVLOOP_NO_EXIT_ON_EMPTY);
+            poll_config ? run_busy_poll() : run();
+            frames.unbind();
             log->debug("Event loop run returned, thread finished");
         });
 
@@ -254,16 +338,22 @@ namespace wshttp
 
         stop_thread();
 
-        for (auto& [id, list] : tickers)
-        {
-            std::for_each(list.begin(), list.end(), [](auto& t) {
-                if (auto tick = t.lock())
-                {
-                    tick->f = nullptr;
-                    tick->stop();
-                }
-            });
-        }
+        // tickers may outlive the loop in the hands of the application; detach them so they never reach back in
+        tickers.release_all([](ev_watcher& w) {
+            w.f = nullptr;
+            w._is_running = false;
+        });
+
+        // pending timers (and their captures) go down with the wheels
+        fine_timers.reset();
+        coarse_timers.reset();
+
+        uring.reset();
+
+        flush_ev.reset();
+        job_waker.reset();
+        if (job_wake_fd >= 0)
+            close(job_wake_fd);
 
         log->info("Loop shutdown complete");
 
@@ -272,55 +362,169 @@ namespace wshttp
 #endif
     }
 
-    void event_loop::stop_thread(bool immediate)
+    bool event_loop::run_pass(int flags)
     {
-        log->debug("Stopping loop thread...");
-        if (loop_thread)
-            immediate ? event_base_loopbreak(ev_loop.get()) : event_base_loopexit(ev_loop.get(), nullptr);
+        event_base_loop(ev_loop.get(), flags);
 
-        if (loop_thread and loop_thread->joinable())
-            loop_thread->join();
+        auto start = std::exchange(busy_since, {});
+        if (start == std::chrono::steady_clock::time_point{})
+            return false;
+
+        metrics.iteration.record(detail::get_time() - start);
+        return true;
     }
 
-    void event_loop::clear_old_tickers()
+    void event_loop::run()
     {
-        for (auto& [id, list] : tickers)
+        // One pass per libevent iteration, so that the busy time of each can be recorded
+        while (not stopping.load(std::memory_order_acquire))
+            run_pass(EVLOOP_ONCE | EVLOOP_NO_EXIT_ON_EMPTY);
+    }
+
+    static void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    void event_loop::run_busy_poll()
+    {
+        log->info(
+            "Event loop busy polling with a spin window of {}-{}us",
+            poll_config->min_spin.count(),
+            poll_config->max_spin.count());
+
+        while (not stopping.load(std::memory_order_acquire))
         {
-            for (auto itr = list.begin(); itr != list.end();)
+            // While spinning, `wake_pending` is held set so that producers skip signalling the waker; the job queue is
+            // polled directly instead
+            wake_pending.store(true, std::memory_order_release);
+
+            auto spin_until = detail::get_time() + spin_window;
+            bool found_work{false};
+
+            while (not stopping.load(std::memory_order_acquire))
             {
-                if (itr->expired())
-                    itr = list.erase(itr);
+                bool worked = run_pass(EVLOOP_NONBLOCK);
+
+                if (not job_queue.empty() or background_ready())
+                {
+                    process_job_queue();
+                    wake_pending.store(true, std::memory_order_release);
+                    worked = true;
+                }
+
+                auto now = detail::get_time();
+
+                if (worked)
+                {
+                    found_work = true;
+                    spin_until = now + spin_window;
+                }
+                else if (now >= spin_until)
+                    break;
                 else
-                    ++itr;
+                    cpu_relax();
             }
+
+            if (not found_work)
+                spin_window = std::max<std::chrono::nanoseconds>(spin_window / 2, poll_config->min_spin);
+
+            // Hand wakeups back to producers. Anything pushed before this exchange is visible below; anything after it
+            // signals the waker itself
+            wake_pending.exchange(false, std::memory_order_acq_rel);
+
+            if (not job_queue.empty() or background_ready())
+                continue;
+
+            auto blocked_at = detail::get_time();
+            run_pass(EVLOOP_ONCE | EVLOOP_NO_EXIT_ON_EMPTY);
+
+            if (detail::get_time() - blocked_at <= poll_config->max_spin)
+                spin_window = std::min<std::chrono::nanoseconds>(spin_window * 2, poll_config->max_spin);
         }
     }
 
-    std::shared_ptr<ev_watcher> event_loop::make_handler(caller_id_t _id)
+    void event_loop::stop_thread(bool immediate)
     {
-        clear_old_tickers();
-        auto t = make_shared<ev_watcher>();
-        tickers[_id].push_back(t);
-        return t;
+        log->debug("Stopping loop thread...");
+        if (loop_thread and not stopping.exchange(true, std::memory_order_acq_rel))
+        {
+            // A break requested between two passes would be lost (each pass resets it), so it is posted as a job: that
+            // wakes the loop for a final pass, after which it sees `stopping`
+            call_soon([this, immediate]() {
+                if (immediate)
+                    event_base_loopbreak(ev_loop.get());
+            });
+        }
+
+        if (loop_thread and loop_thread->joinable())
+            loop_thread->join();
+
+        running = false;
     }
 
-    void event_loop::stop_tickers(caller_id_t id)
+    void event_loop::add_handler(caller_id_t _id, const std::shared_ptr<ev_watcher>& w)
     {
-        if (auto it = tickers.find(id); it != tickers.end())
-        {
-            for (auto& t : it->second)
+        call([this, _id, weak = std::weak_ptr{w}]() {
+            if (auto t = weak.lock())
             {
-                if (auto tick = t.lock())
-                {
-                    tick->f = nullptr;
-                    tick->stop();
-                }
+                t->_id = tickers.add(_id, t.get());
+                t->_sync();
             }
-        }
+        });
+    }
+
+    void event_loop::stop_tickers(caller_id_t id)
+    {
+        call_get([&]() {
+            tickers.release(id, [](ev_watcher& w) {
+                w.f = nullptr;
+                w._is_running = false;
+                w._sync();
+            });
+        });
     }
 
     void event_loop::setup_job_waker()
     {
+#ifdef WSHTTP_USE_EVENTFD
+        // Waking through our own eventfd lets producers signal with a single write(2), without taking the event_base
+        // lock that cross-thread `event_active` needs
+        if (job_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); job_wake_fd >= 0)
+        {
+            job_waker.reset(event_new(
+                ev_loop.get(),
+                job_wake_fd,
+                EV_READ | EV_PERSIST,
+                [](evutil_socket_t fd, short, void* self) {
+                    eventfd_t val;
+                    eventfd_read(fd, &val);
+                    log->trace("processing job queue");
+                    static_cast<event_loop*>(self)->process_job_queue();
+                },
+                this));
+
+            if (job_waker and event_add(job_waker.get(), nullptr) == 0)
+            {
+                log->debug("Event loop using eventfd job waker");
+                return;
+            }
+
+            job_waker.reset();
+            close(job_wake_fd);
+            job_wake_fd = -1;
+        }
+
+        if (lock_free())
+            throw std::runtime_error{"Failed to set up eventfd job waker for single-threaded event loop"};
+
+        log->warn("Failed to register eventfd job waker; falling back to libevent notification");
+#endif
+
         job_waker.reset(event_new(
             ev_loop.get(),
             -1,
@@ -333,24 +537,175 @@ namespace wshttp
         assert(job_waker);
     }
 
+    void event_loop::wake_loop()
+    {
+#ifdef WSHTTP_USE_EVENTFD
+        if (job_wake_fd >= 0)
+        {
+            eventfd_write(job_wake_fd, 1);
+            return;
+        }
+#endif
+        // cross-thread activation takes the base's lock, which a lock-free loop does not have
+        assert(not lock_free());
+        event_active(job_waker.get(), 0, 0);
+    }
+
+    void event_loop::mark_dirty(session_base& s)
+    {
+        assert(in_event_loop());
+
+        // the first session marked in an iteration schedules the flush; it runs once everything already active has
+        dirty_sessions.push_back(&s);
+
+        if (dirty_sessions.size() == 1)
+            event_active(flush_ev.get(), 0, 0);
+    }
+
+    void event_loop::forget_dirty(session_base& s)
+    {
+        assert(in_event_loop());
+
+        std::ranges::replace(dirty_sessions, &s, nullptr);
+        std::ranges::replace(flushing, &s, nullptr);
+    }
+
+    void event_loop::flush_dirty()
+    {
+        assert(in_event_loop());
+        callback_probe probe{*this};
+
+        // sessions marked while flushing (e.g. by a flush closing its session) land in a fresh batch and flush event
+        std::swap(flushing, dirty_sessions);
+
+        for (size_t i = 0; i < flushing.size(); ++i)
+            if (auto* s = flushing[i])
+                s->flush();
+
+        flushing.clear();
+    }
+
     void event_loop::process_job_queue()
     {
         log->trace("Event loop processing job queue");
         assert(in_event_loop());
+        callback_probe probe{*this};
+
+        // Re-arm before looking at the queue: anything published after this point signals a fresh wakeup, anything
+        // published before it is visible to the drain below
+        wake_pending.exchange(false, std::memory_order_acq_rel);
+
+        // Only run what was queued on entry, within the budget; anything posted by these jobs, or left over, waits for
+        // the next wakeup so that socket I/O gets its turn in between
+        auto deadline = std::chrono::steady_clock::now() + job_budget_time;
+        auto queued = job_queue.size_approx(), bg_queued = bg_job_queue.size_approx();
+        metrics.queue_depth.record(queued + bg_queued);
+
+        auto n = run_jobs(job_queue, std::min(queued, job_budget_count), deadline);
+        jobs_run += n;
+
+        auto bg_max = std::min(bg_queued, std::max(job_budget_count - n, BACKGROUND_JOB_MIN));
+        auto bg = run_background_jobs(bg_max, deadline);
+
+        log->trace("Event loop processed {} jobs ({} background)", n + bg, bg);
 
-        decltype(job_queue) swapped_queue;
+        // a held back background job needs no wakeup of its own: the latency-critical jobs it waits for bring one
+        if ((not job_queue.empty() or background_ready())
+            and not wake_pending.exchange(true, std::memory_order_acq_rel))
+            wake_loop();
+    }
+
+    bool event_loop::background_ready()
+    {
+        auto* j = bg_job_queue.front();
+        return j and j->after <= jobs_run;
+    }
+
+    size_t event_loop::run_background_jobs(size_t max, std::chrono::steady_clock::time_point deadline)
+    {
+        size_t n{0};
 
+        // one at a time, as each may be held back by its predecessors; past the deadline, only the guaranteed share
+        while (n < max and background_ready())
         {
-            std::lock_guard<std::mutex> lock{job_queue_mutex};
-            job_queue.swap(swapped_queue);
+            n += run_jobs(bg_job_queue, 1, deadline);
+
+            if (n >= BACKGROUND_JOB_MIN and std::chrono::steady_clock::now() >= deadline)
+                break;
         }
 
-        while (not swapped_queue.empty())
+        return n;
+    }
+
+    size_t event_loop::run_jobs(
+        mpsc_queue<detail::queued_job>& q, size_t max, std::chrono::steady_clock::time_point deadline)
+    {
+        // checking the clock after every job would cost more than most jobs do
+        static constexpr size_t CLOCK_CHECK_INTERVAL{16};
+
+        size_t n{0};
+
+        while (n < max)
         {
-            auto job = swapped_queue.front();
-            swapped_queue.pop();
-            job();
+            auto ran = q.drain(
+                [this](detail::queued_job& j) {
+                    if (j.posted == std::chrono::steady_clock::time_point{})
+                        return j.job();
+
+                    auto start = detail::get_time();
+                    metrics.job_wait.record(start - j.posted);
+                    j.job();
+                    metrics.job_run.record(detail::get_time() - start);
+                },
+                std::min(max - n, CLOCK_CHECK_INTERVAL));
+            n += ran;
+
+            if (ran == 0 or std::chrono::steady_clock::now() >= deadline)
+                break;
         }
+
+        return n;
+    }
+
+    callback_probe::callback_probe(event_loop& l) : _loop{l}, _start{detail::get_time()}
+    {
+        // every libevent callback goes through here; on a lock-free loop, one off the loop thread would be a data race
+        assert(_loop.in_event_loop());
+
+        if (_loop.busy_since == std::chrono::steady_clock::time_point{})
+            _loop.busy_since = _start;
+    }
+
+    callback_probe::~callback_probe()
+    {
+        _loop.metrics.callback.record(detail::get_time() - _start);
+    }
+
+    std::shared_ptr<event_loop_pool> event_loop_pool::make(
+        size_t n, bool pin, std::optional<busy_poll_config> busy_poll, loop_mode mode)
+    {
+        return std::shared_ptr<event_loop_pool>{new event_loop_pool{n, pin, busy_poll, mode}};
+    }
+
+    event_loop_pool::event_loop_pool(size_t n, bool pin, std::optional<busy_poll_config> busy_poll, loop_mode mode)
+    {
+        auto cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+        if (n == 0)
+            n = cores;
+
+        _loops.reserve(n);
+
+        for (size_t i = 0; i < n; ++i)
+            _loops.push_back(event_loop::make(
+                pin ? std::make_optional(static_cast<uint32_t>(i % cores)) : std::nullopt, busy_poll, mode));
+
+        log->info("Started event loop pool of {} loops{}", n, pin ? " pinned to cores" : "");
+    }
+
+    const std::shared_ptr<event_loop>& event_loop_pool::next()
+    {
+        return _loops[_next.fetch_add(1, std::memory_order_relaxed) % _loops.size()];
     }
 
 }  //  namespace wshttp
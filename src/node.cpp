@@ -5,21 +5,28 @@
 #include "internal.hpp"
 #include "session.hpp"
 
+#include <algorithm>
+
 namespace wshttp
 {
     node::~node()
     {
         log->debug("Closing outbound node to host: {}", _uri.host());
+        _reaper.reset();
     }
 
-    void node::close_session(std::string host)
+    void node::close_session(outbound_session* s)
     {
         assert(_ep.in_event_loop());
-        _ep.call([&]() {
-            if (_sessions.erase(host))
-                log->info("Listener closed session to remote: {}", host);
+        _ep.call([&, s]() {
+            if (auto it = std::ranges::find(_sessions, s, &std::shared_ptr<outbound_session>::get);
+                it != _sessions.end())
+            {
+                _sessions.erase(it);
+                log->info("Node closed session to host: {} ({} remaining)", _uri.host(), _sessions.size());
+            }
             else
-                log->warn("Listener failed to find session (remote: {}) to close!", host);
+                log->warn("Node failed to find session (host: {}) to close!", _uri.host());
         });
     }
 
@@ -27,73 +34,141 @@ namespace wshttp
     {
         assert(_ep.in_event_loop());
 
-        if (_local.has_value())
+        if (_pool.idle_timeout > 0ms)
+            _reaper = _ep.call_every(_pool.reap_interval(), [this]() { reap_idle(); }, timer_res::coarse);
+    }
+
+    evutil_socket_t node::bind_socket()
+    {
+        assert(_ep.in_event_loop());
+
+        if (not _local.has_value())
+            return -1;
+
+        evutil_socket_t fd = socket(_local->is_ipv4() ? AF_INET : AF_INET6, SOCK_STREAM, 0);
+
+        if (fd < 0)
+            throw std::runtime_error{"Could not create socket for outbound node: {}"_format(detail::current_error())};
+
+        if (auto rv = evutil_make_socket_nonblocking(fd); rv < 0)
         {
-            _fd = socket(_local->is_ipv4() ? AF_INET : AF_INET6, SOCK_STREAM, 0);
+            evutil_closesocket(fd);
+            throw std::runtime_error{"Failed to non-block outbound node socket: {}"_format(detail::current_error())};
+        }
 
-            if (auto rv = evutil_make_socket_nonblocking(_fd); rv < 0)
-                throw std::runtime_error{
-                    "Failed to non-block outbound node socket: {}"_format(detail::current_error())};
+        // Every connection of the pool goes to the same host and port, so only the first may take a configured local
+        // port; the rest bind just the address and leave the port to connect(), which picks one free for its 4-tuple
+        auto port = _sessions.empty() ? _local->port() : uint16_t{0};
 
-            if (_fd < 0)
-                throw std::runtime_error{
-                    "Could not create socket for outbound node: {}"_format(detail::current_error())};
+        if (port != 0)
+        {
+            int val = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+        }
+#ifdef IP_BIND_ADDRESS_NO_PORT
+        else
+        {
+            int val = 1;
+            setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &val, sizeof(val));
+        }
+#endif
 
-            if (_local->is_ipv4())
-            {
-                sockaddr_in _in4;
-                _in4.sin_family = AF_INET;
-                _in4.sin_addr = *_local;
-                _in4.sin_port = enc::host_to_big(_local->port());
+        int rv;
 
-                if (auto rv = bind(_fd, reinterpret_cast<sockaddr*>(&_in4), sizeof(sockaddr)); rv < 0)
-                    throw std::runtime_error{"Outbound node failed to bind socket: {}"_format(detail::current_error())};
-            }
-            else
-            {
-                sockaddr_in6 _in6;
-                _in6.sin6_family = AF_INET6;
-                _in6.sin6_addr = *_local;
-                _in6.sin6_port = enc::host_to_big(_local->port());
+        if (_local->is_ipv4())
+        {
+            sockaddr_in _in4{};
+            _in4.sin_family = AF_INET;
+            _in4.sin_addr = *_local;
+            _in4.sin_port = enc::host_to_big(port);
 
-                if (auto rv = bind(_fd, reinterpret_cast<sockaddr*>(&_in6), sizeof(sockaddr)); rv < 0)
-                    throw std::runtime_error{"Outbound node failed to bind socket: {}"_format(detail::current_error())};
-            }
+            rv = bind(fd, reinterpret_cast<sockaddr*>(&_in4), sizeof(_in4));
+        }
+        else
+        {
+            sockaddr_in6 _in6{};
+            _in6.sin6_family = AF_INET6;
+            _in6.sin6_addr = *_local;
+            _in6.sin6_port = enc::host_to_big(port);
+
+            rv = bind(fd, reinterpret_cast<sockaddr*>(&_in6), sizeof(_in6));
+        }
 
-            log->info("Outbound node successfully bound socket: {}", *_local);
+        if (rv < 0)
+        {
+            auto err = detail::current_error();
+            evutil_closesocket(fd);
+            throw std::runtime_error{"Outbound node failed to bind socket: {}"_format(err)};
         }
+
+        log->info("Outbound node successfully bound socket: {}", *_local);
+        return fd;
     }
 
-    void node::handle_nd_opts(ip_address local)
+    void node::handle_nd_opt(ip_address local)
     {
         log->trace("Outbound node configured to connect from local address: {}", local);
         _local = local;
     }
 
-    void node::create_outbound_session()
+    void node::handle_nd_opt(pool_config pool)
     {
-        assert(_ep.in_event_loop());
-        log->debug("Creating outbound session (host: {})", _uri.host());
-        _ep.call_get([&]() {
-            auto [it, b] = _sessions.emplace(_uri.host(), nullptr);
+        if (pool.max_sessions == 0)
+            throw std::invalid_argument{"Outbound node pool needs room for at least one session!"};
+
+        log->trace(
+            "Outbound node configured with up to {} sessions, idle timeout {}ms",
+            pool.max_sessions,
+            pool.idle_timeout.count());
+        _pool = pool;
+    }
 
-            if (not b)
-            {
-                log->critical("Connection to host {} already exists! ...", _uri.host());
-                _sessions.erase(it);
-                return;
-            }
+    std::shared_ptr<outbound_session> node::create_outbound_session()
+    {
+        assert(_ep.in_event_loop());
+        log->debug(
+            "Creating outbound session {} of {} (host: {})", _sessions.size() + 1, _pool.max_sessions, _uri.host());
 
-            it->second = _ep.template make_shared<outbound_session>(*this, _fd, _local);
+        return _ep.call_get([&]() -> std::shared_ptr<outbound_session> {
+            auto s = _ep.template make_shared<outbound_session>(*this, bind_socket(), _local);
 
-            if (not it->second)
+            if (not s)
             {
-                log->critical("Failed to make outbound session to host: {}", it->first);
-                _sessions.erase(it);
+                log->critical("Failed to make outbound session to host: {}", _uri.host());
+                return nullptr;
             }
+
+            return _sessions.emplace_back(std::move(s));
         });
     }
 
+    std::shared_ptr<outbound_session> node::acquire_session()
+    {
+        assert(_ep.in_event_loop());
+
+        auto [use, fallback] = detail::choose_session(_sessions, _pool.max_sessions);
+
+        if (use)
+            return use;
+
+        if (auto s = create_outbound_session())
+            return s;
+
+        return fallback;
+    }
+
+    void node::reap_idle()
+    {
+        assert(_ep.in_event_loop());
+
+        for (auto& s : detail::idle_sessions(_sessions, std::chrono::steady_clock::now(), _pool.idle_timeout))
+        {
+            log->debug(
+                "Reaping outbound session (path: {}) idle for {}ms", s->session_path(), _pool.idle_timeout.count());
+            s->shutdown();
+        }
+    }
+
     SSL* node::new_ssl()
     {
         assert(_ep.in_event_loop());
@@ -103,6 +178,8 @@ namespace wshttp
             if (!_ssl)
                 throw std::runtime_error{"Failed to create SSL/TLS for inbound: {}"_format(detail::current_error())};
 
+            _ep.configure_ssl(_ssl);
+
             return _ssl;
         });
     }
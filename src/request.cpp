@@ -110,3 +110,17 @@ namespace wshttp::req
         _settings.push_back(make_setting(id, val));
     }
 }  // namespace wshttp::req
+
+namespace wshttp
+{
+    body_provider request::from(std::string data)
+    {
+        return [data = std::move(data), off = size_t{0}](std::span<uint8_t> buf, bool& eof) mutable -> nghttp2_ssize {
+            auto n = std::min(buf.size(), data.size() - off);
+            std::memcpy(buf.data(), data.data() + off, n);
+            off += n;
+            eof = off == data.size();
+            return static_cast<nghttp2_ssize>(n);
+        };
+    }
+}  //  namespace wshttp
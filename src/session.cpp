@@ -7,7 +7,11 @@
 
 namespace wshttp
 {
-    static constexpr auto OUTPUT_BLOCK_THRESHOLD{1 << 16};
+    // Minimum span of a throughput sample for adaptive write watermarks
+    static constexpr auto WATERMARK_SAMPLE_INTERVAL{100ms};
+
+    // Input segments handed to nghttp2 per evbuffer_peek call
+    static constexpr int READ_IOVECS{16};
 
     static stream* _get_stream(struct nghttp2_session* s, int32_t id)
     {
@@ -24,6 +28,7 @@ namespace wshttp
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
         auto& s = _get_session(user_arg);
+        callback_probe probe{s._loop};
 
         auto msg = "{}bound session (path: {})"_format(s.is_outbound() ? "Out" : "In", s.session_path());
 
@@ -36,9 +41,16 @@ namespace wshttp
 
             if (not _alpn_len or defaults::ALPN == uspan{_alpn, _alpn_len})
             {
+                s.check_tls_offload();
+
                 log->info(
                     "{} {} alpn; initializing...", msg, _alpn_len ? "successfully negotiated" : "did not negotiate");
-                return s.config_send_initial();
+                s.config_send_initial();
+
+                if (s.is_outbound())
+                    static_cast<outbound_session&>(s).on_connect();
+
+                return;
             }
 
             log->warn(
@@ -61,6 +73,7 @@ namespace wshttp
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
         auto& s = _get_session(user_arg);
+        callback_probe probe{s._loop};
         s.read_session_data();
     }
 
@@ -68,15 +81,17 @@ namespace wshttp
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
         auto& s = _get_session(user_arg);
+        callback_probe probe{s._loop};
         s.write_session_data();
     }
 
-    nghttp2_ssize session_callbacks::send_callback(
-        nghttp2_session* /* session */, const uint8_t* data, size_t datalen, int /* flags */, void* user_arg)
+    void session_callbacks::writable_cb(evutil_socket_t /* fd */, short /* events */, void* user_arg)
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
         auto& s = _get_session(user_arg);
-        return s.send_hook(ustring{data, datalen});
+        callback_probe probe{s._loop};
+        s._sock_writable = true;
+        s.schedule_send();
     }
 
     // int session_callbacks::on_frame_send_callback(nghttp2_session *session, const nghttp2_frame *frame, void
@@ -92,11 +107,20 @@ namespace wshttp
         int32_t stream_id,
         const uint8_t* data,
         size_t datalen,
-        void* /* user_arg */)
+        void* user_arg)
     {
         log->debug("{} called", __PRETTY_FUNCTION__);
-        auto s = _get_stream(session, stream_id);
-        return s->recv_data(ustring{data, datalen});
+        auto& sess = _get_session(user_arg);
+
+        if (auto* s = _get_stream(session, stream_id))
+            return s->recv_data(recv_chunk{sess._recv_block, uspan{data, datalen}});
+
+        // data for a stream we no longer track still counts against the connection window of an outbound session,
+        // whose window updates are up to us; see `stream::consume`
+        if (sess.is_outbound())
+            nghttp2_session_consume_connection(session, datalen);
+
+        return 0;
     }
 
     int session_callbacks::on_frame_recv_callback(
@@ -139,87 +163,412 @@ namespace wshttp
         return s.begin_headers_hook(frame);
     }
 
+    nghttp2_ssize session_callbacks::data_source_read_length_callback(
+        nghttp2_session* /* session */,
+        uint8_t /* frame_type */,
+        int32_t /* stream_id */,
+        int32_t session_remote_window_size,
+        int32_t stream_remote_window_size,
+        uint32_t remote_max_frame_size,
+        void* /* user_arg */)
+    {
+        // nghttp2 caps DATA frames at 16KiB otherwise, whatever the peer allows
+        return std::min<nghttp2_ssize>(
+            {session_remote_window_size, stream_remote_window_size, static_cast<nghttp2_ssize>(remote_max_frame_size)});
+    }
+
+    int session_callbacks::send_data_callback(
+        nghttp2_session* /* session */,
+        nghttp2_frame* frame,
+        const uint8_t* framehd,
+        size_t length,
+        nghttp2_data_source* source,
+        void* user_arg)
+    {
+        log->trace("{} called", __PRETTY_FUNCTION__);
+        auto& s = _get_session(user_arg);
+        auto& st = *static_cast<stream*>(source->ptr);
+        auto* output = bufferevent_get_output(s._bev.get());
+
+        // the frame has to go out whole; nghttp2 retries it once the output has drained
+        if (evbuffer_get_length(output) >= s._high_water)
+            return NGHTTP2_ERR_WOULDBLOCK;
+
+        static constexpr std::array<uint8_t, 256> padding{};
+        auto padlen = frame->data.padlen;
+
+        // With kTLS there is no userspace crypto to feed: unless output is queued ahead of it, or the last direct send
+        // found the socket full, the frame goes straight to the socket, its payload by sendfile; only a short send
+        // leaves the remainder to the output buffer. A header OpenSSL still holds is always retried here first
+        if (s._ktls_send and padlen == 0
+            and (s._ktls_hd_pending or (s._sock_writable and evbuffer_get_length(output) == 0)))
+        {
+            auto rv = s.sendfile_data(framehd, st._file_fd, st._file_sent, length);
+
+            if (rv < 0 and rv != NGHTTP2_ERR_WOULDBLOCK)
+                return NGHTTP2_ERR_CALLBACK_FAILURE;
+
+            if (rv >= 0)
+            {
+                auto sent = static_cast<size_t>(rv);
+                st._file_sent += sent;
+                s._bytes_queued += 9 + sent;
+                length -= sent;
+
+                if (length == 0)
+                    return 0;
+
+                if (evbuffer_add_file_segment(
+                        output, st._file.get(), static_cast<ev_off_t>(st._file_sent), static_cast<ev_off_t>(length))
+                    != 0)
+                {
+                    log->critical("Failed to append file segment for stream (ID:{})", frame->hd.stream_id);
+                    return NGHTTP2_ERR_CALLBACK_FAILURE;
+                }
+
+                st._file_sent += length;
+                s._bytes_queued += length;
+                return 0;
+            }
+        }
+
+        // Frame header (and padding) are copied; the payload is appended by reference to the file segment, which the
+        // bufferevent maps or sends from directly
+        evbuffer_add(output, framehd, 9);
+
+        if (padlen > 0)
+        {
+            uint8_t pad_len = padlen - 1;
+            evbuffer_add(output, &pad_len, 1);
+        }
+
+        if (length > 0
+            and evbuffer_add_file_segment(
+                    output, st._file.get(), static_cast<ev_off_t>(st._file_sent), static_cast<ev_off_t>(length))
+                != 0)
+        {
+            log->critical("Failed to append file segment for stream (ID:{})", frame->hd.stream_id);
+            return NGHTTP2_ERR_CALLBACK_FAILURE;
+        }
+
+        if (padlen > 1)
+            evbuffer_add(output, padding.data(), padlen - 1);
+
+        st._file_sent += length;
+        s._bytes_queued += 9 + length + padlen;
+
+        return 0;
+    }
+
     void session_base::read_session_data()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
         evbuffer* input = bufferevent_get_input(_bev.get());
-        auto inlen = evbuffer_get_length(input);
 
-        auto recv_len = nghttp2_session_mem_recv2(_session.get(), evbuffer_pullup(input, -1), inlen);
+        // Take everything read so far over into a block of our own (moving chains, not bytes), so that body chunks can
+        // borrow from it for as long as their streams hold them; a block no stream kept is reused
+        if (not _recv_block or _recv_block.use_count() > 1)
+            _recv_block = input_block_ptr{evbuffer_new(), deleters::_evbuffer{}};
+
+        auto* block = _recv_block.get();
+        evbuffer_add_buffer(block, input);
+
+        auto inlen = evbuffer_get_length(block);
 
-        if (recv_len < 0)
+        // Feed nghttp2 straight from the buffer's segments rather than linearizing them first; nghttp2 keeps its own
+        // state across frames split between segments
+        std::array<evbuffer_iovec, READ_IOVECS> vecs;
+        size_t consumed{0};
+
+        while (consumed < inlen)
         {
-            log->critical("Fatal error reading {}B from bufferevent: {}", inlen, nghttp2_strerror(recv_len));
-            return close_session();
+            evbuffer_ptr pos;
+            evbuffer_ptr_set(block, &pos, consumed, EVBUFFER_PTR_SET);
+
+            auto n = evbuffer_peek(block, inlen - consumed, &pos, vecs.data(), READ_IOVECS);
+
+            if (n <= 0)
+                break;
+
+            for (int i = 0; i < std::min(n, READ_IOVECS); ++i)
+            {
+                auto& v = vecs[i];
+                auto len = std::min(v.iov_len, inlen - consumed);
+
+                auto recv_len = nghttp2_session_mem_recv2(_session.get(), static_cast<const uint8_t*>(v.iov_base), len);
+
+                if (recv_len < 0)
+                {
+                    log->critical("Fatal error reading {}B from bufferevent: {}", inlen, nghttp2_strerror(recv_len));
+                    return close_session();
+                }
+
+                // only a callback returning NGHTTP2_ERR_PAUSE stops short, and none of ours do
+                if (static_cast<size_t>(recv_len) < len)
+                {
+                    log->critical("nghttp2 took only {}B of a {}B segment from bufferevent", recv_len, len);
+                    return close_session();
+                }
+
+                consumed += len;
+            }
         }
 
-        send_session_data();
+        // a block the streams kept is theirs now; otherwise it is emptied, for the next read to reuse
+        if (_recv_block.use_count() == 1)
+            evbuffer_drain(block, inlen);
+        else
+            _recv_block.reset();
+
+        schedule_send();
     }
 
     void session_base::write_session_data()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        if (evbuffer_get_length(bufferevent_get_output(_bev.get())) > 0)
-        {
-            log->info("Figure out why nghttp2 returns here!");
-            return;
-        }
+        // Invoked once the output has drained down to the low watermark, which the socket just took a write toward
+        _sock_writable = true;
 
-        if (not nghttp2_session_want_read(_session.get()) and not nghttp2_session_want_write(_session.get()))
+        auto outlen = evbuffer_get_length(bufferevent_get_output(_bev.get()));
+        auto want_write = nghttp2_session_want_write(_session.get());
+
+        if (_ep._watermarks.adaptive)
+            adapt_watermarks(want_write ? outlen : 0);
+
+        if (not want_write and not nghttp2_session_want_read(_session.get()))
         {
+            // let whatever is still buffered go out first; this is invoked again once it has
+            if (outlen > 0)
+                return;
+
             log->warn("No more IO to go, closing session...");
             return close_session();
         }
 
+        // refill the output up to the high watermark
         send_session_data();
     }
 
     void session_base::send_session_data()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        if (nghttp2_session_send(_session.get()) != 0)
-            throw std::runtime_error{"Failed to dispatch session data to remote: {}"_format(remote())};
+        auto* output = bufferevent_get_output(_bev.get());
+
+        // Serialized frames are appended straight from nghttp2's own buffer (valid until the next call); past the high
+        // watermark, the rest stays queued in nghttp2 until the output drains to the low one
+        while (evbuffer_get_length(output) < _high_water)
+        {
+            const uint8_t* data{nullptr};
+            auto len = nghttp2_session_mem_send2(_session.get(), &data);
+
+            if (len < 0)
+                throw std::runtime_error{
+                    "Failed to dispatch session data to remote {}: {}"_format(remote(), nghttp2_strerror(len))};
+
+            if (len == 0)
+                break;
+
+            if (evbuffer_add(output, data, static_cast<size_t>(len)) != 0)
+                throw std::runtime_error{"Failed to buffer session data to remote: {}"_format(remote())};
+
+            _bytes_queued += static_cast<uint64_t>(len);
+        }
 
         log->info("Inbound session successfully dispatched session data to remote: {}", remote());
     }
 
-    nghttp2_ssize session_base::send_hook(ustring data)
+    void session_base::schedule_send()
     {
-        assert(_ep.in_event_loop());
-        log->trace("{} called", __PRETTY_FUNCTION__);
+        assert(_loop.in_event_loop());
+
+        if (not std::exchange(_send_scheduled, true))
+            _loop.mark_dirty(*this);
+    }
+
+    void session_base::flush()
+    {
+        assert(_loop.in_event_loop());
+
+        _send_scheduled = false;
+
+        // the session may have been torn down since it was marked
+        if (_session and _bev)
+            send_session_data();
+    }
+
+    session_base::~session_base()
+    {
+        if (_send_scheduled)
+            _loop.forget_dirty(*this);
+    }
+
+    void session_base::apply_watermarks()
+    {
+        auto& wm = _ep._watermarks;
+
+        // libevent only honors the low mark for writes: the write callback fires once the output drains down to it
+        bufferevent_setwatermark(_bev.get(), EV_WRITE, wm.low * _high_water / wm.high, 0);
+    }
+
+    void session_base::adapt_watermarks(size_t outlen)
+    {
+        auto now = detail::get_time();
+        auto sent = _bytes_queued - outlen;
+
+        // only sample while output is backlogged; idle time would otherwise read as low throughput
+        if (outlen == 0 or _sample_start == std::chrono::steady_clock::time_point{})
+        {
+            _sample_start = outlen ? now : std::chrono::steady_clock::time_point{};
+            _sample_sent = sent;
+            return;
+        }
+
+        if (now - _sample_start < WATERMARK_SAMPLE_INTERVAL)
+            return;
+
+#ifdef __linux__
+        tcp_info ti{};
+        socklen_t len = sizeof(ti);
+
+        if (getsockopt(bufferevent_getfd(_bev.get()), IPPROTO_TCP, TCP_INFO, &ti, &len) == 0 and ti.tcpi_rtt > 0)
+        {
+            auto rate = (sent - _sample_sent) / std::chrono::duration<double>(now - _sample_start).count();
+            auto bdp = rate * ti.tcpi_rtt / 1e6;
+
+            // twice the BDP, so that a throughput capped by the current mark still lets it grow
+            auto& wm = _ep._watermarks;
+            auto high = std::clamp(static_cast<size_t>(2 * bdp), wm.high, wm.max);
 
-        return _ep.call_get([&]() -> nghttp2_ssize {
-            if (auto outlen = evbuffer_get_length(bufferevent_get_output(_bev.get())); outlen >= OUTPUT_BLOCK_THRESHOLD)
+            if (high != _high_water)
             {
-                log->warn("Cannot send data (size:{}) with output buffer of size:{}", data.size(), outlen);
+                log->debug(
+                    "Session (path: {}) output high watermark {} -> {} ({:.0f}B/s, rtt {}us)",
+                    _path,
+                    _high_water,
+                    high,
+                    rate,
+                    ti.tcpi_rtt);
+                _high_water = high;
+                apply_watermarks();
+            }
+        }
+#endif
+
+        _sample_start = now;
+        _sample_sent = sent;
+    }
+
+    void session_base::check_tls_offload()
+    {
+        _ktls_send = BIO_get_ktls_send(SSL_get_wbio(_ssl.get()));
+        _ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(_ssl.get()));
+
+        if (_ep._tls_mode == tls_mode::kernel)
+            log->info(
+                "Session (path: {}) TLS offload -- send: {}, receive: {}",
+                _path,
+                _ktls_send ? "kernel" : "userspace",
+                _ktls_recv ? "kernel" : "userspace");
+    }
+
+    nghttp2_ssize session_base::sendfile_data(const uint8_t* framehd, int fd, uint64_t offset, size_t length)
+    {
+        auto* ssl = _ssl.get();
+
+        // The frame header is a record of its own. If the socket won't take it, OpenSSL holds on to it and insists the
+        // next write retry it, so nghttp2 retries this frame (before any other) once the socket turns writable
+        if (auto rv = SSL_write(ssl, framehd, 9); rv != 9)
+        {
+            if (SSL_get_error(ssl, rv) == SSL_ERROR_WANT_WRITE)
+            {
+                _ktls_hd_pending = true;
+                wait_writable();
                 return NGHTTP2_ERR_WOULDBLOCK;
             }
 
-            bufferevent_write(_bev.get(), data.data(), data.size());
-            return data.size();
-        });
+            log->critical(
+                "Session (path: {}) failed to write frame header over kTLS: {}", _path, detail::current_error());
+            ERR_clear_error();
+            return NGHTTP2_ERR_CALLBACK_FAILURE;
+        }
+
+        _ktls_hd_pending = false;
+
+        if (length == 0)
+            return 0;
+
+        auto n = SSL_sendfile(ssl, fd, static_cast<off_t>(offset), length, 0);
+
+        if (n < 0)
+        {
+            // nothing sent; the caller queues the whole payload behind the header, for the bufferevent to drain
+            if (SSL_get_error(ssl, static_cast<int>(n)) == SSL_ERROR_WANT_WRITE)
+            {
+                _sock_writable = false;
+                return 0;
+            }
+
+            log->critical("Session (path: {}) failed to sendfile over kTLS: {}", _path, detail::current_error());
+            ERR_clear_error();
+            return NGHTTP2_ERR_CALLBACK_FAILURE;
+        }
+
+        if (static_cast<size_t>(n) < length)
+            _sock_writable = false;
+
+        return static_cast<nghttp2_ssize>(n);
+    }
+
+    void session_base::wait_writable()
+    {
+        assert(_loop.in_event_loop());
+
+        _sock_writable = false;
+
+        if (not _writable_ev)
+            _writable_ev.reset(event_new(
+                _loop.loop().get(), bufferevent_getfd(_bev.get()), EV_WRITE, session_callbacks::writable_cb, this));
+
+        event_add(_writable_ev.get(), nullptr);
     }
 
     void session_base::config_send_initial()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        return _ep.call_get([this]() {
+        return _loop.call_get([this]() {
             initialize_session();
             send_initial();
         });
     }
 
+    void session_base::submit_settings(const h2_settings& s)
+    {
+        auto entries = s.entries();
+
+        if (auto rv = nghttp2_submit_settings(_session.get(), NGHTTP2_FLAG_NONE, entries.data(), entries.size());
+            rv != 0)
+            throw std::runtime_error{"Failed to submit {}bound session settings: {}"_format(
+                is_outbound() ? "out" : "in", nghttp2_strerror(rv))};
+
+        if (s.connection_window_size)
+            if (auto rv = nghttp2_session_set_local_window_size(
+                    _session.get(), NGHTTP2_FLAG_NONE, 0, static_cast<int32_t>(*s.connection_window_size));
+                rv != 0)
+                throw std::runtime_error{"Failed to set {}bound session connection window: {}"_format(
+                    is_outbound() ? "out" : "in", nghttp2_strerror(rv))};
+    }
+
     std::shared_ptr<inbound_session> inbound_session::make(listener& l, ip_address remote, evutil_socket_t fd)
     {
-        return l._ep.template make_shared<inbound_session>(l, std::move(remote), fd);
+        return l._loop.template make_shared<inbound_session>(l, std::move(remote), fd);
     }
 
     inbound_session::~inbound_session()
@@ -227,6 +576,15 @@ namespace wshttp
         log->trace("Inbound session (path: {}) deleted...", _path);
     }
 
+    outbound_session::outbound_session(node& n, evutil_socket_t fd, std::optional<ip_address> local)
+        : session_base{n._ep, *n._ep._loop, fd, path{local ? std::move(*local) : ip_address{}, {}}, true},
+          _n{n},
+          _host{_n._uri.host()},
+          _connected{_loop}
+    {
+        _init_internals();
+    }
+
     outbound_session::~outbound_session()
     {
         log->trace("Outbound session (path: {}) deleted...", _path);
@@ -234,19 +592,19 @@ namespace wshttp
 
     void inbound_session::_init_internals()
     {
-        assert(_ep.in_event_loop());
-        _ep.call_get([&]() {
+        assert(_loop.in_event_loop());
+        _loop.call_get([&]() {
             _ssl.reset(_lst.new_ssl());
 
             if (not _ssl)
                 throw std::runtime_error{"Failed to emplace SSL pointer for new inbound session"};
 
             _bev.reset(bufferevent_openssl_socket_new(
-                _ep._loop->loop().get(),
+                _loop.loop().get(),
                 _fd,
                 _ssl.get(),
                 BUFFEREVENT_SSL_ACCEPTING,
-                BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS | BEV_OPT_THREADSAFE));
+                BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS | (_loop.lock_free() ? 0 : BEV_OPT_THREADSAFE)));
 
             if (not _bev)
                 throw std::runtime_error{
@@ -275,6 +633,9 @@ namespace wshttp
             bufferevent_setcb(
                 _bev.get(), session_callbacks::read_cb, session_callbacks::write_cb, session_callbacks::event_cb, this);
 
+            _high_water = _ep._watermarks.high;
+            apply_watermarks();
+
             bufferevent_enable(_bev.get(), EV_READ | EV_WRITE);
 
             log->info("Successfully configured inbound session; path: {}", _path);
@@ -283,19 +644,22 @@ namespace wshttp
 
     void outbound_session::_init_internals()
     {
-        assert(_ep.in_event_loop());
-        _ep.call_get([&]() {
+        assert(_loop.in_event_loop());
+        _loop.call_get([&]() {
             _ssl.reset(_n.new_ssl());
 
             if (not _ssl)
                 throw std::runtime_error{"Failed to emplace SSL pointer for new outbound session"};
 
+            if (_ep._ctx->client_sessions().resume(_ssl.get(), "{}:{}"_format(_host, HTTPS_PORT)))
+                log->debug("Outbound session (host: {}) offering cached TLS session", _host);
+
             _bev.reset(bufferevent_openssl_socket_new(
-                _ep._loop->loop().get(),
+                _loop.loop().get(),
                 _fd,
                 _ssl.get(),
                 BUFFEREVENT_SSL_CONNECTING,
-                BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS | BEV_OPT_THREADSAFE));
+                BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS | (_loop.lock_free() ? 0 : BEV_OPT_THREADSAFE)));
 
             if (not _bev)
                 throw std::runtime_error{
@@ -306,6 +670,9 @@ namespace wshttp
             bufferevent_setcb(
                 _bev.get(), session_callbacks::read_cb, session_callbacks::write_cb, session_callbacks::event_cb, this);
 
+            _high_water = _ep._watermarks.high;
+            apply_watermarks();
+
             bufferevent_enable(_bev.get(), EV_READ | EV_WRITE);
 
             if (bufferevent_socket_connect_hostname(_bev.get(), *_ep._dns, AF_INET, get_uri().host().data(), HTTPS_PORT)
@@ -318,10 +685,10 @@ namespace wshttp
 
     void inbound_session::close_session()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        _ep.call_soon([&]() {
+        _loop.call_soon([&]() {
             log->info("Session (path: {}) signaled listener to close connection...", _path);
             _lst.close_session(_path.remote());
         });
@@ -329,26 +696,121 @@ namespace wshttp
 
     void outbound_session::on_connect()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        //
+        _last_active = std::chrono::steady_clock::now();
+        _connected.set(true);
+
+        _ep._ctx->client_sessions().record(_ssl.get());
+
+        if (_pending.empty())
+            return;
+
+        log->debug("Outbound session (host: {}) submitting {} queued requests", _host, _pending.size());
+
+        for (auto& s : std::exchange(_pending, {}))
+            submit_stream(s);
+
+        schedule_send();
+    }
+
+    std::shared_ptr<stream> outbound_session::submit(request req, response_handler handler)
+    {
+        assert(_loop.in_event_loop());
+
+        if (not accepts_streams())
+        {
+            log->warn("Outbound session (host: {}) no longer accepts requests!", _host);
+            return nullptr;
+        }
+
+        auto s = _loop.template shared_ptr<stream>(
+            new stream{*this, std::move(req), std::move(handler)}, deleters::stream_d);
+
+        if (not _session)
+            return _pending.emplace_back(std::move(s));
+
+        if (submit_stream(s) != 0)
+            return nullptr;
+
+        // goes out with everything else submitted this iteration
+        schedule_send();
+
+        return s;
+    }
+
+    int outbound_session::submit_stream(const std::shared_ptr<stream>& s)
+    {
+        assert(_loop.in_event_loop());
+
+        if (auto rv = s->submit_request(_host); rv != 0)
+        {
+            s->recv_close(NGHTTP2_REFUSED_STREAM);
+            return rv;
+        }
+
+        _streams.emplace(s->id(), s);
+        return 0;
+    }
+
+    uint32_t outbound_session::stream_capacity() const
+    {
+        // until the peer's SETTINGS arrive, assume the minimum RFC 9113 recommends rather than nghttp2's unlimited
+        if (not _session or not _peer_settings)
+            return DEFAULT_PEER_MAX_STREAMS;
+
+        return nghttp2_session_get_remote_settings(_session.get(), NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+    }
+
+    bool outbound_session::accepts_streams() const
+    {
+        return not _closing and (not _session or nghttp2_session_check_request_allowed(_session.get()));
+    }
+
+    void outbound_session::shutdown()
+    {
+        assert(_loop.in_event_loop());
+
+        if (std::exchange(_closing, true))
+            return;
+
+        if (not _session)
+            return close_session();
+
+        if (auto rv = nghttp2_session_terminate_session(_session.get(), NGHTTP2_NO_ERROR); rv != 0)
+        {
+            log->warn("Call to `nghttp2_session_terminate_session` failed; reason: {}", nghttp2_strerror(rv));
+            return close_session();
+        }
+
+        // the write callback closes the session once nghttp2 has nothing left to send or receive
+        schedule_send();
     }
 
     void outbound_session::close_session()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        _ep.call_soon([&]() {
+        _closing = true;
+        _connected.set(false);
+
+        // streams stay in `_streams` (nghttp2 refers to them) until the session goes; closing them twice is a no-op
+        for (auto& s : std::exchange(_pending, {}))
+            s->recv_close(NGHTTP2_REFUSED_STREAM);
+        for (auto& [id, s] : _streams)
+            s->recv_close(NGHTTP2_CANCEL);
+
+        _loop.call_soon([&]() {
             log->info("Session (path: {}) signaled node to close connection...", _path);
-            _n.close_session(_host);
+            _n.close_session(this);
         });
     }
 
     void inbound_session::initialize_session()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
 
         nghttp2_option* opt;
         nghttp2_session* _sess;
@@ -358,8 +820,6 @@ namespace wshttp
 
         nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, session_callbacks::on_stream_close_callback);
 
-        nghttp2_session_callbacks_set_send_callback2(callbacks, session_callbacks::send_callback);
-
         nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, session_callbacks::on_frame_recv_callback);
 
         nghttp2_session_callbacks_set_on_begin_headers_callback(
@@ -367,6 +827,12 @@ namespace wshttp
 
         nghttp2_session_callbacks_set_on_header_callback(callbacks, session_callbacks::on_header_callback);
 
+        nghttp2_session_callbacks_set_data_source_read_length_callback2(
+            callbacks, session_callbacks::data_source_read_length_callback);
+
+        // file responses send their DATA frames themselves (NGHTTP2_DATA_FLAG_NO_COPY)
+        nghttp2_session_callbacks_set_send_data_callback(callbacks, session_callbacks::send_data_callback);
+
         // nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, nullptr);
         // nghttp2_session_callbacks_set_before_frame_send_callback(callbacks, nullptr);
         // nghttp2_session_callbacks_set_on_frame_send_callback(callbacks, nullptr);
@@ -380,14 +846,14 @@ namespace wshttp
         if (auto rv = nghttp2_session_server_new2(&_sess, callbacks, this, opt); rv != 0)
             throw std::runtime_error{"Failed to initialize inbound session: {}"_format(nghttp2_strerror(rv))};
 
-        _session = _ep.template shared_ptr<nghttp2_session>(_sess, deleters::_session{});
+        _session = _loop.template shared_ptr<nghttp2_session>(_sess, deleters::_session{});
 
         log->info("Inbound session initialized and set callbacks!");
     }
 
     void outbound_session::initialize_session()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
 
         int val = 1;
         if (setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val)) < 0)
@@ -412,8 +878,6 @@ namespace wshttp
 
         nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, session_callbacks::on_stream_close_callback);
 
-        nghttp2_session_callbacks_set_send_callback2(callbacks, session_callbacks::send_callback);
-
         nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, session_callbacks::on_frame_recv_callback);
 
         nghttp2_session_callbacks_set_on_begin_headers_callback(
@@ -421,58 +885,61 @@ namespace wshttp
 
         nghttp2_session_callbacks_set_on_header_callback(callbacks, session_callbacks::on_header_callback);
 
+        nghttp2_session_callbacks_set_data_source_read_length_callback2(
+            callbacks, session_callbacks::data_source_read_length_callback);
+
         nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
             callbacks, session_callbacks::on_data_chunk_recv_callback);
         // nghttp2_session_callbacks_set_before_frame_send_callback(callbacks, nullptr);
         // nghttp2_session_callbacks_set_on_frame_send_callback(callbacks, nullptr);
         // nghttp2_session_callbacks_set_on_frame_not_send_callback(callbacks, nullptr);
 
-        if (auto rv = nghttp2_session_client_new(&_sess, callbacks, this); rv != 0)
+        nghttp2_option* opt;
+
+        if (auto rv = nghttp2_option_new(&opt); rv != 0)
+            throw std::runtime_error{"Failed to create nghttp2 session option struct: {}"_format(nghttp2_strerror(rv))};
+
+        // response bodies return their flow-control credit once the application has consumed them, not on receipt
+        nghttp2_option_set_no_auto_window_update(opt, 1);
+
+        if (auto rv = nghttp2_session_client_new2(&_sess, callbacks, this, opt); rv != 0)
             throw std::runtime_error{"Failed to initialize outbound session: {}"_format(nghttp2_strerror(rv))};
 
-        _session = _ep.template shared_ptr<nghttp2_session>(_sess, deleters::_session{});
+        _session = _loop.template shared_ptr<nghttp2_session>(_sess, deleters::_session{});
 
         log->info("Outbound session initialized and set callbacks!");
     }
 
     void inbound_session::send_initial()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        req::settings _settings;
-        _settings.add_setting(NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100);
-
-        if (auto rv = nghttp2_submit_settings(_session.get(), NGHTTP2_FLAG_NONE, _settings, _settings.size()); rv != 0)
-            throw std::runtime_error{"Failed to submit inbound session settings: {}"_format(nghttp2_strerror(rv))};
+        submit_settings(_ep._h2.inbound);
 
         log->info("Inbound session successfully submitted nghttp2 settings!");
 
-        send_session_data();
+        schedule_send();
     }
 
     void outbound_session::send_initial()
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        req::settings _settings;
-        _settings.add_setting(NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100);
-
-        if (auto rv = nghttp2_submit_settings(_session.get(), NGHTTP2_FLAG_NONE, _settings, _settings.size()); rv != 0)
-            throw std::runtime_error{"Failed to submit outbound session settings: {}"_format(nghttp2_strerror(rv))};
+        submit_settings(_ep._h2.outbound);
 
         log->info("Outbound session successfully submitted nghttp2 settings!");
 
-        
+        schedule_send();
     }
 
     int inbound_session::stream_close_hook(int32_t stream_id, uint32_t error_code)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        return _ep.call_get([&]() {
+        return _loop.call_get([&]() {
             if (_streams.erase(stream_id))
             {
                 log->info("Closed inbound stream (ID:{}, ec:{})", stream_id, error_code);
@@ -485,19 +952,18 @@ namespace wshttp
 
     int outbound_session::stream_close_hook(int32_t stream_id, uint32_t error_code)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        return _ep.call_get([&]() -> int {
-            if (_streams.erase(stream_id))
+        return _loop.call_get([&]() -> int {
+            // the session stays open for the node's next requests, until it has idled past the pool's timeout
+            if (auto it = _streams.find(stream_id); it != _streams.end())
             {
-                log->info("Closed outbound stream (ID:{}, ec:{}); terminating session...", stream_id, error_code);
-                if (auto rv = nghttp2_session_terminate_session(_session.get(), NGHTTP2_NO_ERROR); rv != 0)
-                {
-                    log->warn("Call to `nghttp2_session_terminate_session` failed; reason: {}", nghttp2_strerror(rv));
-                    return NGHTTP2_ERR_CALLBACK_FAILURE;
-                }
-                close_session();
+                it->second->recv_close(error_code);
+                _streams.erase(it);
+                _last_active = std::chrono::steady_clock::now();
+                log->info(
+                    "Closed outbound stream (ID:{}, ec:{}); {} remain open", stream_id, error_code, _streams.size());
             }
             else
                 log->warn("Could not find outbound stream (ID:{}); received error code: {}", stream_id, error_code);
@@ -507,7 +973,7 @@ namespace wshttp
 
     int inbound_session::begin_headers_hook(const nghttp2_frame* frame)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
         if (frame->hd.type != NGHTTP2_HEADERS or frame->headers.cat != NGHTTP2_HCAT_REQUEST)
@@ -516,7 +982,7 @@ namespace wshttp
             return 0;
         }
 
-        return _ep.call_get([&]() {
+        return _loop.call_get([&]() {
             auto& stream_id = frame->hd.stream_id;
 
             // create stream
@@ -542,7 +1008,7 @@ namespace wshttp
 
     int outbound_session::begin_headers_hook(const nghttp2_frame* frame)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
         if (frame->hd.type != NGHTTP2_HEADERS or frame->headers.cat != NGHTTP2_HCAT_REQUEST)
@@ -555,7 +1021,7 @@ namespace wshttp
 
     int inbound_session::recv_header_hook(const nghttp2_frame* frame, uspan name, uspan value)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
         if (frame->hd.type != NGHTTP2_HEADERS or frame->headers.cat != NGHTTP2_HCAT_REQUEST)
@@ -564,7 +1030,7 @@ namespace wshttp
         }
         else if (req::fields::path == name)
         {
-            return _ep.call_get([&]() -> int {
+            return _loop.call_get([&]() -> int {
                 auto& stream_id = frame->hd.stream_id;
 
                 if (auto it = _streams.find(stream_id); it != _streams.end())
@@ -582,20 +1048,22 @@ namespace wshttp
 
     int outbound_session::recv_header_hook(const nghttp2_frame* frame, uspan name, uspan value)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        if (frame->hd.type != NGHTTP2_HEADERS or frame->headers.cat != NGHTTP2_HCAT_RESPONSE)
+        // final responses after a 1xx, and trailers, come in NGHTTP2_HCAT_HEADERS blocks
+        if (frame->hd.type != NGHTTP2_HEADERS
+            or (frame->headers.cat != NGHTTP2_HCAT_RESPONSE and frame->headers.cat != NGHTTP2_HCAT_HEADERS))
         {
             log->debug("Ignoring non-header and non hcat-response frames...");
             return 0;
         }
 
-        return _ep.call_get([&]() -> int {
+        return _loop.call_get([&]() -> int {
             auto& stream_id = frame->hd.stream_id;
 
             if (auto it = _streams.find(stream_id); it != _streams.end())
-                return it->second->recv_header(req::headers{name, value});
+                return it->second->recv_header(name, value);
 
             log->critical("Could not find outbound stream of id:{} to recv header!", stream_id);
             return NGHTTP2_ERR_CALLBACK_FAILURE;
@@ -604,10 +1072,10 @@ namespace wshttp
 
     int inbound_session::frame_recv_hook(const nghttp2_frame* frame)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        return _ep.call_get([&]() -> int {
+        return _loop.call_get([&]() -> int {
             auto& stream_id = frame->hd.stream_id;
 
             switch (frame->hd.type)
@@ -636,18 +1104,25 @@ namespace wshttp
 
     int outbound_session::frame_recv_hook(const nghttp2_frame* frame)
     {
-        assert(_ep.in_event_loop());
+        assert(_loop.in_event_loop());
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        if (frame->hd.type == NGHTTP2_HEADERS and frame->headers.cat == NGHTTP2_HCAT_RESPONSE)
+        if (frame->hd.type == NGHTTP2_HEADERS)
+        {
             log->debug("All headers received on stream (ID: {})", frame->hd.stream_id);
 
+            if (auto it = _streams.find(frame->hd.stream_id); it != _streams.end())
+                return it->second->recv_response();
+        }
+        else if (frame->hd.type == NGHTTP2_SETTINGS and not(frame->hd.flags & NGHTTP2_FLAG_ACK))
+            _peer_settings = true;
+
         return 0;
     }
 
     std::shared_ptr<stream> inbound_session::make_stream(int32_t stream_id)
     {
-        assert(_ep.in_event_loop());
-        return _ep.template shared_ptr<stream>(new stream{*this, _session, stream_id}, deleters::stream_d);
+        assert(_loop.in_event_loop());
+        return _loop.template shared_ptr<stream>(new stream{*this, stream_id}, deleters::stream_d);
     }
 }  //  namespace wshttp
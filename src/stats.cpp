@@ -0,0 +1,12 @@
+#include "stats.hpp"
+
+#include "internal.hpp"
+
+namespace wshttp
+{
+    std::string histogram_snapshot::to_string() const
+    {
+        return "n={} mean={:.0f} p50={} p99={} p999={} max={}"_format(
+            count, mean(), percentile(0.5), percentile(0.99), percentile(0.999), max);
+    }
+}  //  namespace wshttp
@@ -4,6 +4,8 @@
 #include "internal.hpp"
 #include "session.hpp"
 
+#include <charconv>
+
 namespace wshttp
 {
     ssize_t stream_callbacks::file_read_callback(
@@ -16,10 +18,11 @@ namespace wshttp
         void* /* user_data */)
     {
         auto fd = source->fd;
-        ssize_t ret{-1};
+        ssize_t ret;
 
-        while (ret == -1 and errno == EINTR)
+        do
             ret = read(fd, buf, length);
+        while (ret == -1 and errno == EINTR);
 
         if (ret == -1)
         {
@@ -30,32 +33,244 @@ namespace wshttp
         {
             log->critical("stream file read returning 'NGHTTP2_DATA_FLAG_EOF'");
             *data_flags |= NGHTTP2_DATA_FLAG_EOF;
-            return NGHTTP2_DATA_FLAG_EOF;
+            return 0;
         }
 
         return ret;
     }
 
-    stream::stream(inbound_session& s, const session_ptr& sess, int32_t id)
-        : _s{s}, _session{sess.get(), deleters::_session{}}, dir{IO::INBOUND}, _id{id}
+    nghttp2_ssize stream_callbacks::file_segment_read_callback(
+        nghttp2_session* /* session */,
+        int32_t /* stream_id */,
+        uint8_t* /* buf */,
+        size_t length,
+        uint32_t* data_flags,
+        nghttp2_data_source* source,
+        void* /* user_data */)
+    {
+        auto& s = *static_cast<stream*>(source->ptr);
+        auto len = std::min<uint64_t>(length, s._file_size - s._file_sent);
+
+        // the frame itself is written by session_callbacks::send_data_callback
+        *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+
+        if (s._file_sent + len == s._file_size)
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+
+        return static_cast<nghttp2_ssize>(len);
+    }
+
+    nghttp2_ssize stream_callbacks::body_read_callback(
+        nghttp2_session* /* session */,
+        int32_t /* stream_id */,
+        uint8_t* buf,
+        size_t length,
+        uint32_t* data_flags,
+        nghttp2_data_source* source,
+        void* /* user_data */)
+    {
+        auto& s = *static_cast<stream*>(source->ptr);
+        bool eof{false};
+
+        auto rv = s._out.body(std::span<uint8_t>{buf, length}, eof);
+
+        if (rv == NGHTTP2_ERR_DEFERRED)
+            return rv;
+
+        if (rv < 0)
+        {
+            log->warn("Body provider of outbound stream (ID:{}) failed; resetting stream", s._id);
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        }
+
+        if (eof)
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+
+        return rv;
+    }
+
+    void recv_buffer::push(recv_chunk c)
+    {
+        _size += c.data.size();
+        _chunks.push_back(std::move(c));
+        _resume_waiter();
+    }
+
+    void recv_buffer::close()
+    {
+        _closed = true;
+        _resume_waiter();
+    }
+
+    void recv_buffer::_resume_waiter()
+    {
+        if (auto* w = std::exchange(_waiter, nullptr))
+        {
+            w->_readable = not empty();
+            w->_wake = detail::resume_cancellable(_loop, w->_h);
+        }
+    }
+
+    size_t recv_buffer::pop(size_t n)
+    {
+        size_t dropped{0};
+
+        while (n > 0 and not _chunks.empty())
+        {
+            auto& c = _chunks.front();
+
+            if (c.data.size() > n)
+            {
+                c.data = uspan{c.data.data() + n, c.data.size() - n};
+                dropped += n;
+                break;
+            }
+
+            n -= c.data.size();
+            dropped += c.data.size();
+            _chunks.pop_front();
+        }
+
+        _size -= dropped;
+        return dropped;
+    }
+
+    size_t recv_buffer::peek(std::span<iovec> out) const
+    {
+        size_t i{0};
+
+        for (; i < out.size() and i < _chunks.size(); ++i)
+            out[i] = iovec{const_cast<unsigned char*>(_chunks[i].data.data()), _chunks[i].data.size()};
+
+        return i;
+    }
+
+    stream::stream(inbound_session& s, int32_t id)
+        : _s{s}, dir{IO::INBOUND}, _id{id}, _done{_s._loop}, _body{_s._loop}, _nghttp2{_s._session}
     {
         log->debug("Inbound stream (ID: {}) created!", _id);
     }
 
-    stream::stream(outbound_session& s, const session_ptr& sess, int32_t id)
-        : _s{s}, _session{sess.get(), deleters::_session{}}, dir{IO::OUTBOUND}, _id{id}
+    stream::~stream()
+    {
+        // credit for body bytes never consumed still has to go back to the connection window, or it shrinks for good;
+        // the WINDOW_UPDATE goes out with the session's next write
+        if (auto sess = _nghttp2.lock(); sess and _body.size() and dir == IO::OUTBOUND)
+            nghttp2_session_consume_connection(sess.get(), _body.size());
+    }
+
+    stream::stream(outbound_session& s, request req, response_handler h)
+        : _s{s},
+          dir{IO::OUTBOUND},
+          _id{0},
+          _out{std::move(req)},
+          _handler{std::move(h)},
+          _done{_s._loop},
+          _body{_s._loop}
+    {
+        log->debug("Outbound stream ({} {}) created!", _out.method, _out.path);
+    }
+
+    nghttp2_session* stream::session() const
+    {
+        return _s._session.get();
+    }
+
+    static uspan as_uspan(std::string_view s)
+    {
+        return {reinterpret_cast<const unsigned char*>(s.data()), s.size()};
+    }
+
+    int stream::submit_request(std::string_view authority)
+    {
+        log->trace("{} called", __PRETTY_FUNCTION__);
+
+        _out_hdrs.add_field(req::FIELD::method, as_uspan(_out.method));
+        _out_hdrs.add_field(req::FIELD::scheme, req::scheme::https);
+        _out_hdrs.add_field(req::FIELD::authority, as_uspan(authority));
+        _out_hdrs.add_field(req::FIELD::path, as_uspan(_out.path));
+
+        for (auto& [name, value] : _out.headers)
+            _out_hdrs.add_pair(as_uspan(name), as_uspan(value));
+
+        nghttp2_data_provider2 _prv{.source = {.ptr = this}, .read_callback = stream_callbacks::body_read_callback};
+
+        auto id = nghttp2_submit_request2(
+            session(), nullptr, _out_hdrs, _out_hdrs.size(), _out.body ? &_prv : nullptr, this);
+
+        if (id < 0)
+        {
+            log->warn("Failed to submit outbound request ({} {}): {}", _out.method, _out.path, nghttp2_strerror(id));
+            return id;
+        }
+
+        _id = id;
+        _nghttp2 = _s._session;
+        log->debug("Submitted outbound request (ID:{}): {} {}", _id, _out.method, _out.path);
+        return 0;
+    }
+
+    void stream::resume_body()
     {
-        log->debug("Outbound stream (ID: {}) created!", _id);
+        assert(_s._loop.in_event_loop());
+
+        if (_closed or not _id)
+            return;
+
+        if (auto rv = nghttp2_session_resume_data(session(), _id); rv != 0)
+            log->warn("Failed to resume body of stream (ID:{}): {}", _id, nghttp2_strerror(rv));
+        else
+            _s.schedule_send();
     }
 
-    int stream::recv_data(ustring data)
+    int stream::recv_data(recv_chunk data)
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        log->info("Stream (ID:{}) received data: {}", _id, buffer_printer{data});
+        if (dir != IO::OUTBOUND)
+        {
+            log->debug("Inbound stream (ID:{}) received {}B of request body", _id, data.data.size());
+            return 0;
+        }
+
+        if (not _handler.on_data)
+        {
+            _body.push(std::move(data));
+            return 0;
+        }
+
+        // the view is only good for the call, so its credit is returned as soon as the handler is done with it
+        _handler.on_data(data.data);
+
+        if (auto rv = nghttp2_session_consume(session(), _id, data.data.size()); rv != 0)
+        {
+            log->critical("Failed to consume {}B on stream (ID:{}): {}", data.data.size(), _id, nghttp2_strerror(rv));
+            return NGHTTP2_ERR_CALLBACK_FAILURE;
+        }
+
         return 0;
     }
 
+    void stream::consume(size_t n)
+    {
+        assert(_body._loop.in_event_loop());
+
+        auto len = _body.pop(n);
+
+        // once the session is gone there is no window left to return credit to, and `_s` must not be touched: it only
+        // holds the nghttp2 session, so a successful lock on the loop thread means it is still around
+        auto sess = _nghttp2.lock();
+
+        if (len == 0 or not sess)
+            return;
+
+        // for a stream that has since closed, this only updates the connection window
+        if (auto rv = nghttp2_session_consume(sess.get(), _id, len); rv != 0)
+            log->warn("Failed to consume {}B on stream (ID:{}): {}", len, _id, nghttp2_strerror(rv));
+        else
+            _s.schedule_send();
+    }
+
     int stream::recv_path_header(uspan path)
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
@@ -64,14 +279,64 @@ namespace wshttp
         return _req ? 0 : NGHTTP2_ERR_CALLBACK_FAILURE;
     }
 
-    int stream::recv_header(req::headers hdr)
+    int stream::recv_header(uspan name, uspan value)
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
 
-        hdr.print();
+        std::string_view v{reinterpret_cast<const char*>(value.data()), value.size()};
+
+        if (req::fields::status == name)
+        {
+            if (std::from_chars(v.data(), v.data() + v.size(), _resp.status).ec != std::errc{})
+            {
+                log->warn("Outbound stream (ID:{}) received malformed status: {}", _id, v);
+                return NGHTTP2_ERR_CALLBACK_FAILURE;
+            }
+        }
+        else
+            _resp.headers.emplace_back(std::string{reinterpret_cast<const char*>(name.data()), name.size()}, v);
+
         return 0;
     }
 
+    int stream::recv_response()
+    {
+        log->trace("{} called", __PRETTY_FUNCTION__);
+
+        // interim (1xx) responses are dropped; the final one follows in another header block
+        if (_resp.status >= 100 and _resp.status < 200)
+        {
+            log->debug("Outbound stream (ID:{}) received interim response {}", _id, _resp.status);
+            _resp = response{};
+            return 0;
+        }
+
+        // anything after the final header block is trailers, which only show up in the response passed to on_close
+        if (std::exchange(_headers_done, true))
+            return 0;
+
+        if (_handler.on_headers)
+            _handler.on_headers(_resp);
+
+        return 0;
+    }
+
+    void stream::recv_close(uint32_t error_code)
+    {
+        log->trace("{} called", __PRETTY_FUNCTION__);
+
+        if (std::exchange(_closed, true))
+            return;
+
+        _resp.error_code = error_code;
+        _body.close();
+
+        if (_handler.on_close)
+            _handler.on_close(_resp);
+
+        _done.set(_resp);
+    }
+
     int stream::recv_frame()
     {
         log->trace("{} called", __PRETTY_FUNCTION__);
@@ -94,6 +359,10 @@ namespace wshttp
 
         _fd = rv;
 
+        struct stat st;
+        if (fstat(_fd, &st) == 0 and S_ISREG(st.st_mode))
+            return send_file_response(req::headers::make_status(req::CODE::_200), static_cast<uint64_t>(st.st_size));
+
         rv = send_response(req::headers::make_status(req::CODE::_200));
         if (rv != 0)
             close(_fd);
@@ -108,7 +377,7 @@ namespace wshttp
         if (pipe(_pipes.data()) != 0)
         {
             log->warn("Failed to create pipes to send error! Resetting stream");
-            if (nghttp2_submit_rst_stream(_session.get(), NGHTTP2_FLAG_NONE, _id, NGHTTP2_INTERNAL_ERROR) != 0)
+            if (nghttp2_submit_rst_stream(session(), NGHTTP2_FLAG_NONE, _id, NGHTTP2_INTERNAL_ERROR) != 0)
             {
                 log->critical("Could not submit stream reset! Fatal error!");
                 return NGHTTP2_ERR_FATAL;
@@ -143,7 +412,36 @@ namespace wshttp
 
         nghttp2_data_provider2 _prv{.source = {_fd}, .read_callback = stream_callbacks::file_read_callback};
 
-        if (auto rv = nghttp2_submit_response2(_session.get(), _id, hdrs, hdrs.size(), &_prv); rv != 0)
+        if (auto rv = nghttp2_submit_response2(session(), _id, hdrs, hdrs.size(), &_prv); rv != 0)
+        {
+            log->critical("Fatal 'nghttp2_submit_response2' error: {}", nghttp2_strerror(rv));
+            return NGHTTP2_ERR_FATAL;
+        }
+
+        return 0;
+    }
+
+    int stream::send_file_response(req::headers hdrs, uint64_t size)
+    {
+        log->trace("{} called", __PRETTY_FUNCTION__);
+
+        // The segment takes over the fd, closing it once neither this stream nor the session output references it
+        _file.reset(evbuffer_file_segment_new(_fd, 0, static_cast<ev_off_t>(size), EVBUF_FS_CLOSE_ON_FREE));
+
+        if (not _file)
+        {
+            log->warn("Failed to map file for stream (ID:{}); falling back to buffered reads", _id);
+            return send_response(std::move(hdrs));
+        }
+
+        _file_fd = std::exchange(_fd, -1);
+        _file_size = size;
+        _file_sent = 0;
+
+        nghttp2_data_provider2 _prv{
+            .source = {.ptr = this}, .read_callback = stream_callbacks::file_segment_read_callback};
+
+        if (auto rv = nghttp2_submit_response2(session(), _id, hdrs, hdrs.size(), &_prv); rv != 0)
         {
             log->critical("Fatal 'nghttp2_submit_response2' error: {}", nghttp2_strerror(rv));
             return NGHTTP2_ERR_FATAL;
@@ -0,0 +1,443 @@
+#include "timer.hpp"
+
+#include "internal.hpp"
+#include "loop.hpp"
+
+#include <bit>
+
+namespace wshttp
+{
+    void loop_callbacks::timer_tick(evutil_socket_t /* fd */, short /* what */, void* user_arg)
+    {
+        auto* wheel = static_cast<timer_wheel*>(user_arg);
+        callback_probe probe{wheel->_loop};
+        wheel->_armed = timer_wheel::UNARMED;
+        wheel->_advance();
+        wheel->_rearm();
+    }
+
+    bool timer_handle::cancel()
+    {
+        if (not _state)
+            return false;
+
+        auto w = _state->wheel.lock();
+        uint8_t status = state::PENDING;
+
+        if (not w or not _state->status.compare_exchange_strong(status, state::CANCELLED, std::memory_order_acq_rel))
+            return false;
+
+        // the outcome is already settled; what is left is taking the timer off the wheel, whenever the loop gets to it
+        w->_loop.call([s = _state]() {
+            if (auto w = s->wheel.lock())
+                w->_cancel(s->id);
+        });
+
+        return true;
+    }
+
+    bool timer_handle::pending() const
+    {
+        return _state and not _state->wheel.expired()
+            and _state->status.load(std::memory_order_acquire) == state::PENDING;
+    }
+
+    std::shared_ptr<timer_wheel> timer_wheel::make(event_loop& l, loop_ptr base, std::chrono::microseconds tick)
+    {
+        return std::shared_ptr<timer_wheel>{new timer_wheel{l, std::move(base), tick}};
+    }
+
+    timer_wheel::timer_wheel(event_loop& l, loop_ptr base, std::chrono::microseconds tick)
+        : _loop{l}, _base{std::move(base)}, _tick{tick}, _origin{detail::get_time()}
+    {
+        _slots.fill(NIL);
+
+        _ev.reset(event_new(_base.get(), -1, 0, loop_callbacks::timer_tick, this));
+
+        if (not _ev)
+            throw std::runtime_error{"Failed to create timer wheel tick event!"};
+
+        log->trace("Timer wheel created with {}us tick", _tick.count());
+    }
+
+    timer_wheel::~timer_wheel()
+    {
+        _ev.reset();
+        log->trace("Timer wheel destroyed with {} pending timers", _count);
+    }
+
+    timer_handle timer_wheel::reserve(Job f)
+    {
+        return timer_handle{std::make_shared<timer_handle::state>(weak_from_this(), std::move(f))};
+    }
+
+    uint64_t timer_wheel::_ticks_until(std::chrono::steady_clock::time_point t, bool round_up) const
+    {
+        if (t <= _origin)
+            return 0;
+
+        auto d = std::chrono::duration_cast<std::chrono::microseconds>(t - _origin);
+        auto n = static_cast<uint64_t>(d / _tick);
+
+        // never fire early: a deadline that falls inside a tick is served at the end of that tick
+        if (round_up and d % _tick != 0us)
+            ++n;
+
+        return n;
+    }
+
+    timer_handle timer_wheel::_schedule(
+        std::chrono::steady_clock::time_point when, Job f, std::chrono::microseconds interval, bool wait)
+    {
+        auto h = reserve(std::move(f));
+        _schedule(h, when, interval, wait);
+        return h;
+    }
+
+    void timer_wheel::_schedule(
+        const timer_handle& h,
+        std::chrono::steady_clock::time_point when,
+        std::chrono::microseconds interval,
+        bool wait)
+    {
+        assert(_loop.in_event_loop());
+
+        // cancelled before it got here
+        if (h._state->status.load(std::memory_order_acquire) != timer_handle::state::PENDING)
+        {
+            h._state->f = nullptr;
+            return;
+        }
+
+        // nothing to cascade while the wheel is empty, so catch the cursor up to the present
+        if (_count == 0)
+            _next_tick = std::max(_next_tick, _ticks_until(detail::get_time(), false));
+
+        uint32_t idx;
+
+        if (_free.empty())
+        {
+            idx = static_cast<uint32_t>(_slab.size());
+            _slab.emplace_back();
+        }
+        else
+        {
+            idx = _free.back();
+            _free.pop_back();
+        }
+
+        auto& n = _slab[idx];
+        n.f = std::move(h._state->f);
+        n.expires = _ticks_until(when, true);
+        n.interval = interval > 0us ? std::max<uint64_t>(1, (interval + _tick - 1us) / _tick) : 0;
+        n.wait = wait;
+        n.live = true;
+        n.handle = h._state;
+        n.handle->id = timer_id{idx, n.gen};
+
+        _link(idx);
+        ++_count;
+
+        if (n.expires < _armed)
+            _rearm();
+    }
+
+    bool timer_wheel::_pending(timer_id id) const
+    {
+        return id.index < _slab.size() and _slab[id.index].gen == id.gen and _slab[id.index].live;
+    }
+
+    bool timer_wheel::_cancel(timer_id id)
+    {
+        assert(_loop.in_event_loop());
+
+        if (not _pending(id))
+            return false;
+
+        if (_slab[id.index].linked)
+            _unlink(id.index);
+
+        _release(id.index);
+        return true;
+    }
+
+    void timer_wheel::_release(uint32_t idx)
+    {
+        auto& n = _slab[idx];
+        n.f = nullptr;
+        n.handle.reset();
+        n.live = false;
+        ++n.gen;
+        _free.push_back(idx);
+        --_count;
+    }
+
+    void timer_wheel::_link(uint32_t idx)
+    {
+        auto& n = _slab[idx];
+
+        auto e = std::max(n.expires, _next_tick);
+        auto delta = e - _next_tick;
+        size_t slot;
+
+        if (delta < L0_SIZE)
+        {
+            slot = e & L0_MASK;
+            _l0_occupied[slot / 64] |= uint64_t{1} << (slot % 64);
+        }
+        else
+        {
+            // timers beyond the horizon park in the farthest slot and are re-filed when cascaded
+            if (delta > MAX_DELTA)
+                e = _next_tick + MAX_DELTA;
+
+            int level = 1;
+            while (level < LEVELS - 1 and delta >= uint64_t{1} << (L0_BITS + level * LN_BITS))
+                ++level;
+
+            slot = L0_SIZE + (level - 1) * LN_SIZE + ((e >> (L0_BITS + (level - 1) * LN_BITS)) & LN_MASK);
+        }
+
+        n.slot = static_cast<uint16_t>(slot);
+        n.prev = NIL;
+        n.next = _slots[slot];
+        if (n.next != NIL)
+            _slab[n.next].prev = idx;
+        _slots[slot] = idx;
+        n.linked = true;
+    }
+
+    void timer_wheel::_unlink(uint32_t idx)
+    {
+        auto& n = _slab[idx];
+
+        if (n.prev != NIL)
+            _slab[n.prev].next = n.next;
+        else
+            _slots[n.slot] = n.next;
+
+        if (n.next != NIL)
+            _slab[n.next].prev = n.prev;
+
+        if (n.slot < L0_SIZE and _slots[n.slot] == NIL)
+            _l0_occupied[n.slot / 64] &= ~(uint64_t{1} << (n.slot % 64));
+
+        n.prev = n.next = NIL;
+        n.linked = false;
+    }
+
+    void timer_wheel::_cascade(int level, uint64_t index)
+    {
+        auto slot = L0_SIZE + (level - 1) * LN_SIZE + index;
+
+        auto idx = std::exchange(_slots[slot], NIL);
+
+        while (idx != NIL)
+        {
+            auto next = _slab[idx].next;
+            _slab[idx].linked = false;
+            _link(idx);
+            idx = next;
+        }
+    }
+
+    void timer_wheel::_fire(uint32_t idx)
+    {
+        auto& n = _slab[idx];
+
+        // cancelled from off the loop, with the unlinking still on its way; a one-shot timer is settled as fired here
+        if (n.handle)
+        {
+            uint8_t status = timer_handle::state::PENDING;
+
+            if (n.interval == 0 ? not n.handle->status.compare_exchange_strong(status, timer_handle::state::FIRED)
+                                : n.handle->status.load(std::memory_order_acquire) != status)
+            {
+                _release(idx);
+                return;
+            }
+        }
+
+        auto gen = n.gen;
+        auto f = std::move(n.f);
+
+        _loop.metrics.timer_lag.record(detail::get_time() - (_origin + _tick * static_cast<int64_t>(n.expires)));
+
+        if (n.interval == 0)
+            _release(idx);
+
+        try
+        {
+            f();
+        }
+        catch (const std::exception& e)
+        {
+            log->critical("Timer caught exception: {}", e.what());
+        }
+
+        // the callback may have cancelled (or even reused) this slot, and may have grown the slab; the timer is only
+        // linked again once its slot is drained, as one a full rotation away would land right back in it
+        if (auto& m = _slab[idx]; m.live and m.gen == gen and not m.linked)
+        {
+            m.f = std::move(f);
+            m.expires = m.wait ? _ticks_until(detail::get_time(), true) + m.interval
+                               : std::max(m.expires + m.interval, _next_tick);
+            _refile.push_back(idx);
+        }
+    }
+
+    void timer_wheel::_advance()
+    {
+        _advance_to(_ticks_until(detail::get_time(), false));
+    }
+
+    void timer_wheel::_advance_to(uint64_t target)
+    {
+        assert(_loop.in_event_loop());
+
+        while (_next_tick <= target and _count > 0)
+        {
+            auto index = _next_tick & L0_MASK;
+
+            if (index == 0)
+            {
+                for (int level = 1; level < LEVELS; ++level)
+                {
+                    auto i = (_next_tick >> (L0_BITS + (level - 1) * LN_BITS)) & LN_MASK;
+                    _cascade(level, i);
+                    if (i != 0)
+                        break;
+                }
+            }
+
+            if (_slots[index] == NIL)
+            {
+                // jump straight to the next occupied level 0 slot, or to the next cascade point
+                _next_tick = std::min((_next_tick & ~L0_MASK) + _next_occupied(index), target + 1);
+                continue;
+            }
+
+            ++_next_tick;
+
+            while (_slots[index] != NIL)
+            {
+                auto idx = _slots[index];
+                _unlink(idx);
+                _fire(idx);
+            }
+
+            // skipping any cancelled since, or whose slab entry was reused and scheduled anew
+            for (auto idx : _refile)
+                if (_slab[idx].live and not _slab[idx].linked)
+                    _link(idx);
+
+            _refile.clear();
+        }
+
+        if (_count == 0)
+            _next_tick = std::max(_next_tick, target + 1);
+    }
+
+    uint64_t timer_wheel::_next_occupied(uint64_t index) const
+    {
+        for (auto w = index / 64; w < _l0_occupied.size(); ++w)
+        {
+            auto bits = _l0_occupied[w];
+            if (w == index / 64)
+                bits &= ~uint64_t{0} << (index % 64);
+            if (bits)
+                return w * 64 + std::countr_zero(bits);
+        }
+        return L0_SIZE;
+    }
+
+    bool timer_wheel::_cascade_pending() const
+    {
+        if (_next_tick & L0_MASK)
+            return false;
+
+        // the same slots `_advance` cascades on reaching this tick
+        for (int level = 1; level < LEVELS; ++level)
+        {
+            auto i = (_next_tick >> (L0_BITS + (level - 1) * LN_BITS)) & LN_MASK;
+            if (_slots[L0_SIZE + (level - 1) * LN_SIZE + i] != NIL)
+                return true;
+            if (i != 0)
+                break;
+        }
+
+        return false;
+    }
+
+    uint64_t timer_wheel::_next_due() const
+    {
+        // A cursor left on a block boundary has yet to cascade that block down; whatever comes down may be due before
+        // the first occupied level 0 slot, so wake for the cascade itself
+        if (_cascade_pending())
+            return _next_tick;
+
+        auto index = _next_tick & L0_MASK;
+
+        if (auto n = _next_occupied(index); n < L0_SIZE)
+            return (_next_tick & ~L0_MASK) + n;
+
+        // Level 0 is empty for the rest of this rotation. Slots behind the cursor hold the next rotation's ticks, as
+        // `_link` files anything less than a rotation away in level 0 whatever the slot index wraps to.
+        auto due = UNARMED;
+
+        if (auto n = _next_occupied(0); n < index)
+            due = (_next_tick & ~L0_MASK) + L0_SIZE + n;
+
+        // Wake for the first level 1 slot with something to cascade, but no later than the next level 2 cascade point
+        // if anything is parked above level 1.
+        constexpr uint64_t l2_span{uint64_t{1} << (L0_BITS + LN_BITS)};
+
+        for (size_t s = L0_SIZE + LN_SIZE; s < NUM_SLOTS; ++s)
+        {
+            if (_slots[s] != NIL)
+            {
+                due = std::min(due, (_next_tick + l2_span - 1) & ~(l2_span - 1));
+                break;
+            }
+        }
+
+        auto block = _next_tick >> L0_BITS;
+
+        for (uint64_t k = 1; k <= LN_SIZE; ++k)
+        {
+            if (_slots[L0_SIZE + ((block + k) & LN_MASK)] != NIL)
+                return std::min(due, (block + k) << L0_BITS);
+        }
+
+        return due;
+    }
+
+    void timer_wheel::_rearm()
+    {
+        assert(_loop.in_event_loop());
+
+        if (_count == 0)
+        {
+            if (_armed != UNARMED)
+            {
+                event_del(_ev.get());
+                _armed = UNARMED;
+            }
+            return;
+        }
+
+        auto due = _next_due();
+        assert(due != UNARMED);
+
+        if (due == _armed)
+            return;
+
+        auto now = detail::get_time();
+        auto at = _origin + due * _tick;
+        auto delay = at > now ? std::chrono::duration_cast<std::chrono::microseconds>(at - now) : 0us;
+
+        auto tv = loop_time_to_timeval(delay);
+        event_add(_ev.get(), &tv);
+        _armed = due;
+    }
+}  //  namespace wshttp
@@ -0,0 +1,626 @@
+#include "uring.hpp"
+
+#include "internal.hpp"
+#include "loop.hpp"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace wshttp
+{
+    // user_data of operations whose completions are of no interest (cancellations)
+    static constexpr uint64_t IGNORED_OP{~uint64_t{0}};
+
+    // group id of the provided buffer ring receives select from
+    static constexpr uint16_t RECV_BUFFER_GROUP{0};
+
+    static constexpr size_t RECV_BUFFERS_LEN{size_t{RECV_BUFFER_COUNT} * RECV_BUFFER_SIZE};
+
+    template <typename T>
+    static T load_acquire(T* p)
+    {
+        return std::atomic_ref<T>{*p}.load(std::memory_order_acquire);
+    }
+
+    template <typename T>
+    static void store_release(T* p, T v)
+    {
+        std::atomic_ref<T>{*p}.store(v, std::memory_order_release);
+    }
+
+    std::unique_ptr<io_ring> io_ring::make(event_loop& l, unsigned entries)
+    {
+        std::unique_ptr<io_ring> r{new io_ring{l}};
+
+        if (not r->_init(entries))
+            return nullptr;
+
+        return r;
+    }
+
+    bool io_ring::_init(unsigned entries)
+    {
+        io_uring_params p{};
+        p.flags = IORING_SETUP_CLAMP;
+
+        if (_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p)); _fd < 0)
+        {
+            log->warn("io_uring_setup failed: {}", strerror(errno));
+            return false;
+        }
+
+        _sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        _cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+        bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+
+        if (single_mmap)
+            _sq_len = _cq_len = std::max(_sq_len, _cq_len);
+
+        _sq_ptr = mmap(nullptr, _sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+
+        if (_sq_ptr == MAP_FAILED)
+        {
+            _sq_ptr = nullptr;
+            log->warn("Failed to map io_uring submission ring: {}", strerror(errno));
+            return false;
+        }
+
+        if (single_mmap)
+            _cq_ptr = _sq_ptr;
+        else if (_cq_ptr = mmap(
+                     nullptr, _cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+                 _cq_ptr == MAP_FAILED)
+        {
+            _cq_ptr = nullptr;
+            log->warn("Failed to map io_uring completion ring: {}", strerror(errno));
+            return false;
+        }
+
+        _sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        auto* sqes = mmap(nullptr, _sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+
+        if (sqes == MAP_FAILED)
+        {
+            log->warn("Failed to map io_uring submission entries: {}", strerror(errno));
+            return false;
+        }
+
+        _sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<std::byte*>(_sq_ptr);
+        _sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        _sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        _sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        _sq_flags = reinterpret_cast<unsigned*>(sq + p.sq_off.flags);
+        _sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        _sq_entries = p.sq_entries;
+
+        auto* cq = static_cast<std::byte*>(_cq_ptr);
+        _cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        _cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+
+        if (_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); _efd < 0)
+        {
+            log->warn("Failed to create io_uring completion eventfd: {}", strerror(errno));
+            return false;
+        }
+
+        if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_EVENTFD, &_efd, 1) < 0)
+        {
+            log->warn("Failed to register io_uring completion eventfd: {}", strerror(errno));
+            return false;
+        }
+
+        _cq_ev.reset(event_new(_loop.loop().get(), _efd, EV_READ | EV_PERSIST, _cq_cb, this));
+        _flush_ev.reset(event_new(_loop.loop().get(), -1, 0, _flush_cb, this));
+
+        if (not _cq_ev or not _flush_ev or event_add(_cq_ev.get(), nullptr) != 0)
+        {
+            log->warn("Failed to register io_uring events with the event loop");
+            return false;
+        }
+
+        log->debug("io_uring initialized with {} submission entries", _sq_entries);
+        return true;
+    }
+
+    io_ring::~io_ring()
+    {
+        _cq_ev.reset();
+        _flush_ev.reset();
+
+        if (_sqes)
+            munmap(_sqes, _sqes_len);
+        if (_cq_ptr and _cq_ptr != _sq_ptr)
+            munmap(_cq_ptr, _cq_len);
+        if (_sq_ptr)
+            munmap(_sq_ptr, _sq_len);
+        if (_efd >= 0)
+            close(_efd);
+        if (_fd >= 0)
+            close(_fd);
+        if (_buf_ring)
+            munmap(_buf_ring, _buf_ring_len + RECV_BUFFERS_LEN);
+    }
+
+    bool io_ring::_setup_buffers()
+    {
+        if (_buf_ring or _bufs_failed)
+            return _buf_ring != nullptr;
+
+        // descriptors first, then the buffers, in one mapping: the kernel wants the descriptor ring page aligned
+        _buf_ring_len = RECV_BUFFER_COUNT * sizeof(io_uring_buf);
+        auto* mem = mmap(
+            nullptr, _buf_ring_len + RECV_BUFFERS_LEN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mem == MAP_FAILED)
+        {
+            log->warn("Failed to map io_uring receive buffers: {}", strerror(errno));
+            _bufs_failed = true;
+            return false;
+        }
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(mem);
+        reg.ring_entries = RECV_BUFFER_COUNT;
+        reg.bgid = RECV_BUFFER_GROUP;
+
+        if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            log->warn("Failed to register io_uring receive buffers: {}", strerror(errno));
+            munmap(mem, _buf_ring_len + RECV_BUFFERS_LEN);
+            _bufs_failed = true;
+            return false;
+        }
+
+        _buf_ring = static_cast<io_uring_buf*>(mem);
+        _bufs = static_cast<std::byte*>(mem) + _buf_ring_len;
+
+        for (uint16_t bid = 0; bid < RECV_BUFFER_COUNT; ++bid)
+            _provide(bid);
+
+        log->debug("io_uring receive buffers registered: {} x {}B", RECV_BUFFER_COUNT, RECV_BUFFER_SIZE);
+        return true;
+    }
+
+    void io_ring::_provide(uint16_t bid)
+    {
+        // only addr, len and bid: the ring tail overlays the last field of the first descriptor
+        auto& b = _buf_ring[_buf_tail & (RECV_BUFFER_COUNT - 1)];
+        b.addr = reinterpret_cast<uint64_t>(_bufs + size_t{bid} * RECV_BUFFER_SIZE);
+        b.len = RECV_BUFFER_SIZE;
+        b.bid = bid;
+
+        store_release(&_buf_ring[0].resv, ++_buf_tail);
+    }
+
+    void io_ring::_recycle(uint16_t bid)
+    {
+        --_bufs_out;
+        _provide(bid);
+
+        for (auto* s : std::exchange(_starved, {}))
+            s->_arm_recv();
+    }
+
+    void io_ring::take_buffer(evbuffer* dest, uint16_t bid, size_t len)
+    {
+        ++_bufs_out;
+        evbuffer_add_reference(
+            dest,
+            _bufs + size_t{bid} * RECV_BUFFER_SIZE,
+            len,
+            [](const void* data, size_t, void* self) {
+                auto& r = *static_cast<io_ring*>(self);
+                r._recycle(static_cast<uint16_t>((static_cast<const std::byte*>(data) - r._bufs) / RECV_BUFFER_SIZE));
+            },
+            this);
+    }
+
+    io_uring_sqe* io_ring::_get_sqe()
+    {
+        assert(_loop.in_event_loop());
+
+        auto tail = *_sq_tail;
+
+        if (tail - load_acquire(_sq_head) >= _sq_entries)
+        {
+            submit();
+
+            if (tail - load_acquire(_sq_head) >= _sq_entries)
+                throw std::runtime_error{"io_uring submission queue is full!"};
+        }
+
+        auto idx = tail & _sq_mask;
+        auto* sqe = &_sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        _sq_array[idx] = idx;
+
+        store_release(_sq_tail, tail + 1);
+        ++_to_submit;
+
+        if (not std::exchange(_flush_pending, true))
+            event_active(_flush_ev.get(), 0, 0);
+
+        return sqe;
+    }
+
+    void io_ring::submit()
+    {
+        assert(_loop.in_event_loop());
+
+        while (_to_submit > 0)
+        {
+            auto rv = syscall(__NR_io_uring_enter, _fd, _to_submit, 0, 0, nullptr, 0);
+            ++_enters;
+
+            if (rv < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                // EAGAIN/EBUSY: the kernel is short on resources or the completion queue needs reaping first
+                log->warn("io_uring_enter failed: {}; {} submissions deferred", strerror(errno), _to_submit);
+                if (not std::exchange(_flush_pending, true))
+                    event_active(_flush_ev.get(), 0, 0);
+                return;
+            }
+
+            _to_submit -= static_cast<unsigned>(rv);
+        }
+    }
+
+    io_op_id io_ring::_register(io_callback cb, void* user_arg)
+    {
+        uint32_t idx;
+
+        if (_free.empty())
+        {
+            idx = static_cast<uint32_t>(_ops.size());
+            _ops.emplace_back();
+        }
+        else
+        {
+            idx = _free.back();
+            _free.pop_back();
+        }
+
+        auto& o = _ops[idx];
+        o.cb = cb;
+        o.arg = user_arg;
+        o.live = true;
+
+        return (uint64_t{o.gen} << 32) | (idx + 1);
+    }
+
+    void io_ring::_release(uint32_t idx)
+    {
+        auto& o = _ops[idx];
+        o.cb = nullptr;
+        o.arg = nullptr;
+        o.live = false;
+        ++o.gen;
+        _free.push_back(idx);
+    }
+
+    io_op_id io_ring::accept_multishot(int fd, io_callback cb, void* user_arg)
+    {
+        auto id = _register(cb, user_arg);
+
+        auto* sqe = _get_sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = id;
+
+        return id;
+    }
+
+    io_op_id io_ring::recv_multishot(int fd, io_callback cb, void* user_arg)
+    {
+        if (not _setup_buffers())
+            return 0;
+
+        auto id = _register(cb, user_arg);
+
+        auto* sqe = _get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+        sqe->user_data = id;
+
+        return id;
+    }
+
+    io_op_id io_ring::send(int fd, const msghdr* msg, io_callback cb, void* user_arg)
+    {
+        auto id = _register(cb, user_arg);
+
+        auto* sqe = _get_sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = id;
+
+        return id;
+    }
+
+    void io_ring::rebind(io_op_id id, io_callback cb, void* user_arg)
+    {
+        assert(_loop.in_event_loop());
+
+        auto idx = static_cast<uint32_t>(id & 0xffff'ffff) - 1;
+
+        if (idx >= _ops.size() or _ops[idx].gen != (id >> 32) or not _ops[idx].live)
+            return;
+
+        _ops[idx].cb = cb;
+        _ops[idx].arg = user_arg;
+    }
+
+    void io_ring::cancel(io_op_id id)
+    {
+        assert(_loop.in_event_loop());
+
+        auto idx = static_cast<uint32_t>(id & 0xffff'ffff) - 1;
+
+        if (idx >= _ops.size() or _ops[idx].gen != (id >> 32) or not _ops[idx].live)
+            return;
+
+        _release(idx);
+
+        auto* sqe = _get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = id;
+        sqe->user_data = IGNORED_OP;
+    }
+
+    void io_ring::_reap()
+    {
+        while (true)
+        {
+            auto head = *_cq_head;
+
+            while (head != load_acquire(_cq_tail))
+            {
+                auto cqe = _cqes[head & _cq_mask];
+                store_release(_cq_head, ++head);
+
+                if (cqe.user_data == IGNORED_OP)
+                    continue;
+
+                auto idx = static_cast<uint32_t>(cqe.user_data & 0xffff'ffff) - 1;
+
+                // stale completion for an operation that has since been cancelled
+                if (idx >= _ops.size() or _ops[idx].gen != (cqe.user_data >> 32) or not _ops[idx].live)
+                    continue;
+
+                auto [cb, arg, gen, live] = _ops[idx];
+
+                if (not(cqe.flags & IORING_CQE_F_MORE))
+                    _release(idx);
+
+                cb(cqe.res, cqe.flags, arg);
+            }
+
+            // Completions posted while the queue was full (a burst of multishot accepts or receives) wait in the kernel
+            // until asked for, and signal the eventfd no more; that includes the one ending a multishot operation
+            if (not(load_acquire(_sq_flags) & IORING_SQ_CQ_OVERFLOW))
+                return;
+
+            if (syscall(__NR_io_uring_enter, _fd, 0, 0, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 and errno != EINTR)
+            {
+                log->warn("Failed to flush io_uring completion queue overflow: {}", strerror(errno));
+                return;
+            }
+
+            ++_enters;
+        }
+    }
+
+    void io_ring::_cq_cb(evutil_socket_t fd, short, void* self)
+    {
+        auto& r = *static_cast<io_ring*>(self);
+        callback_probe probe{r._loop};
+
+        eventfd_t val;
+        eventfd_read(fd, &val);
+        r._reap();
+    }
+
+    void io_ring::_mark_dirty(ring_socket& s)
+    {
+        _dirty.push_back(&s);
+
+        if (not std::exchange(_flush_pending, true))
+            event_active(_flush_ev.get(), 0, 0);
+    }
+
+    void io_ring::_forget(ring_socket& s)
+    {
+        std::ranges::replace(_dirty, &s, nullptr);
+        std::ranges::replace(_flushing, &s, nullptr);
+        std::erase(_starved, &s);
+    }
+
+    void io_ring::_flush_cb(evutil_socket_t, short, void* self)
+    {
+        auto& r = *static_cast<io_ring*>(self);
+
+        // sockets first, with `_flush_pending` still set: their sends join this submission instead of scheduling one
+        std::swap(r._flushing, r._dirty);
+
+        for (size_t i = 0; i < r._flushing.size(); ++i)
+            if (auto* s = r._flushing[i])
+                s->_send();
+
+        r._flushing.clear();
+        r._flush_pending = false;
+        r.submit();
+    }
+
+    ring_socket::ring_socket(io_ring& r, int fd, ring_read_cb read_cb, ring_event_cb event_cb, void* user_arg)
+        : _ring{r},
+          _fd{fd},
+          _read_cb{read_cb},
+          _event_cb{event_cb},
+          _user_arg{user_arg},
+          _input{evbuffer_new()},
+          _output{evbuffer_new()},
+          _sending{evbuffer_new()}
+    {}
+
+    std::unique_ptr<ring_socket> ring_socket::make(
+        io_ring& r, int fd, ring_read_cb read_cb, ring_event_cb event_cb, void* user_arg)
+    {
+        assert(r._loop.in_event_loop());
+
+        if (not r._setup_buffers())
+            return nullptr;
+
+        std::unique_ptr<ring_socket> s{new ring_socket{r, fd, read_cb, event_cb, user_arg}};
+        s->_arm_recv();
+
+        return s;
+    }
+
+    ring_socket::~ring_socket()
+    {
+        _ring._forget(*this);
+
+        if (_recv_op)
+            _ring.cancel(_recv_op);
+
+        // the kernel reads the payload of a send in flight until it completes, so it outlives the socket until then
+        if (_send_op)
+            _ring.rebind(
+                _send_op,
+                [](int, uint32_t, void* buf) { evbuffer_free(static_cast<evbuffer*>(buf)); },
+                _sending.release());
+
+        close(_fd);
+    }
+
+    void ring_socket::write(const void* data, size_t len)
+    {
+        assert(_ring._loop.in_event_loop());
+
+        evbuffer_add(_output.get(), data, len);
+
+        if (not std::exchange(_dirty, true))
+            _ring._mark_dirty(*this);
+    }
+
+    size_t ring_socket::pending_output() const
+    {
+        return evbuffer_get_length(_output.get()) + evbuffer_get_length(_sending.get());
+    }
+
+    void ring_socket::_arm_recv()
+    {
+        _recv_op = _ring.recv_multishot(_fd, _recv_cb, this);
+    }
+
+    void ring_socket::_send()
+    {
+        _dirty = false;
+
+        // a send in flight picks up the rest on completion
+        if (_send_op or _done)
+            return;
+
+        evbuffer_add_buffer(_sending.get(), _output.get());
+
+        std::array<evbuffer_iovec, SEND_IOVECS> vecs;
+        auto n = std::min(evbuffer_peek(_sending.get(), -1, nullptr, vecs.data(), SEND_IOVECS), int{SEND_IOVECS});
+
+        if (n <= 0)
+            return;
+
+        for (int i = 0; i < n; ++i)
+            _iov[i] = {vecs[i].iov_base, vecs[i].iov_len};
+
+        _msg = {};
+        _msg.msg_iov = _iov.data();
+        _msg.msg_iovlen = static_cast<size_t>(n);
+
+        _send_op = _ring.send(_fd, &_msg, _send_cb, this);
+    }
+
+    void ring_socket::_fail(short events, int err)
+    {
+        if (std::exchange(_done, true))
+            return;
+
+        errno = err;
+        _event_cb(*this, events, _user_arg);
+    }
+
+    void ring_socket::_recv_cb(int res, uint32_t flags, void* self)
+    {
+        auto& s = *static_cast<ring_socket*>(self);
+
+        if (not(flags & IORING_CQE_F_MORE))
+            s._recv_op = 0;
+
+        if (res > 0)
+        {
+            s._ring.take_buffer(
+                s._input.get(), static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT), static_cast<size_t>(res));
+
+            // the kernel may end a multishot recv at any time (e.g. on completion queue overflow); re-arm before the
+            // callback, which may destroy the socket
+            if (not s._recv_op and not s._done)
+                s._arm_recv();
+
+            return s._read_cb(s, s._user_arg);
+        }
+
+        // a buffer picked for a recv that then failed or hit EOF goes straight back
+        if (flags & IORING_CQE_F_BUFFER)
+            s._ring._provide(static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT));
+
+        if (res == -ENOBUFS and not s._done)
+        {
+            // buffers recycled since the kernel ran out are not going to announce themselves again
+            if (s._ring._bufs_out < RECV_BUFFER_COUNT)
+                s._arm_recv();
+            else
+                s._ring._starved.push_back(&s);
+            return;
+        }
+
+        if (res == 0)
+            return s._fail(BEV_EVENT_EOF, 0);
+
+        s._fail(BEV_EVENT_ERROR, -res);
+    }
+
+    void ring_socket::_send_cb(int res, uint32_t, void* self)
+    {
+        auto& s = *static_cast<ring_socket*>(self);
+        s._send_op = 0;
+
+        if (res < 0)
+            return s._fail(BEV_EVENT_ERROR, -res);
+
+        evbuffer_drain(s._sending.get(), static_cast<size_t>(res));
+
+        if (s.pending_output() > 0 and not std::exchange(s._dirty, true))
+            s._ring._mark_dirty(s);
+    }
+}  //  namespace wshttp
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "types.hpp"
+#include "utils.hpp"
+
+#ifdef WSHTTP_USE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+#include <sys/socket.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace wshttp
+{
+    class event_loop;
+    class ring_socket;
+
+    // Identifies an operation in flight on an io_ring; zero is never a valid id
+    using io_op_id = uint64_t;
+
+    // Invoked on the loop thread for each completion of an operation: `res` is the syscall result (or -errno), `flags`
+    // the raw completion flags (IORING_CQE_F_MORE is set while a multishot operation remains armed)
+    using io_callback = void (*)(int res, uint32_t flags, void* user_arg);
+
+#ifdef WSHTTP_USE_IO_URING
+
+    inline constexpr unsigned DEFAULT_RING_ENTRIES{256};
+
+    // Receive buffers the kernel picks from for every ring_socket on a loop; a power of two
+    inline constexpr uint16_t RECV_BUFFER_COUNT{256};
+    inline constexpr uint32_t RECV_BUFFER_SIZE{16 * 1024};
+
+    // Buffers handed to the kernel per send, at most
+    inline constexpr size_t SEND_IOVECS{64};
+
+    /** io_uring instance owned by an event loop, driven straight through the syscalls (no liburing).
+
+        The ring plugs into libevent rather than replacing it: completions are signalled on an eventfd registered with
+        the ring and watched by the loop like any other fd, so timers, jobs and bufferevents keep working unchanged.
+        Submissions are batched: preparing an operation only fills in a submission entry, and everything queued during
+        one loop iteration goes to the kernel in a single io_uring_enter once the current callbacks have run.
+
+        All methods must be invoked on the loop thread.
+     */
+    class io_ring
+    {
+        friend class event_loop;
+        friend class ring_socket;
+
+        struct op
+        {
+            io_callback cb{nullptr};
+            void* arg{nullptr};
+            uint32_t gen{0};
+            bool live{false};
+        };
+
+        explicit io_ring(event_loop& l) : _loop{l} {}
+
+      public:
+        // Returns nullptr when io_uring is unavailable (old kernel, seccomp, ...), so callers can fall back to libevent
+        static std::unique_ptr<io_ring> make(event_loop& l, unsigned entries = DEFAULT_RING_ENTRIES);
+
+        io_ring(const io_ring&) = delete;
+        io_ring& operator=(const io_ring&) = delete;
+
+        ~io_ring();
+
+        /** Arms a multishot accept on listening socket `fd`: `cb` receives each accepted (non-blocking) fd as `res`.
+            Re-arm if a completion arrives without IORING_CQE_F_MORE.
+         */
+        io_op_id accept_multishot(int fd, io_callback cb, void* user_arg);
+
+        /** Arms a multishot recv on connected socket `fd` into the ring's provided buffers: each completion carries
+            IORING_CQE_F_BUFFER and the buffer id in `flags`, see `take_buffer`. The kernel ends the operation with
+            -ENOBUFS once every buffer is out; re-arm after recycling some. Returns 0 if the kernel lacks provided buffer
+            rings.
+         */
+        io_op_id recv_multishot(int fd, io_callback cb, void* user_arg);
+
+        /** Queues a sendmsg of `msg` on `fd`; `msg`, its iovecs and the bytes they point to must stay valid until the
+            completion (`res` is the number of bytes sent, possibly short).
+         */
+        io_op_id send(int fd, const msghdr* msg, io_callback cb, void* user_arg);
+
+        /** Appends the `len` bytes a recv completion left in provided buffer `bid` to `dest`, by reference; the buffer
+            goes back to the kernel once they are drained
+         */
+        void take_buffer(evbuffer* dest, uint16_t bid, size_t len);
+
+        // Points the completions still to come for `id` at another callback
+        void rebind(io_op_id id, io_callback cb, void* user_arg);
+
+        /** Drops the callback for `id` (it will not be invoked again, even for completions already in flight) and asks
+            the kernel to cancel the operation. */
+        void cancel(io_op_id id);
+
+        // Submits everything queued so far; normally left to the end-of-iteration flush
+        void submit();
+
+        // Number of io_uring_enter calls made so far
+        size_t enters() const { return _enters; }
+
+      private:
+        event_loop& _loop;
+
+        int _fd{-1};
+        int _efd{-1};
+
+        void* _sq_ptr{nullptr};
+        size_t _sq_len{0};
+        void* _cq_ptr{nullptr};
+        size_t _cq_len{0};
+        io_uring_sqe* _sqes{nullptr};
+        size_t _sqes_len{0};
+
+        unsigned* _sq_head{nullptr};
+        unsigned* _sq_tail{nullptr};
+        unsigned* _sq_array{nullptr};
+        unsigned* _sq_flags{nullptr};
+        unsigned _sq_mask{0};
+        unsigned _sq_entries{0};
+
+        unsigned* _cq_head{nullptr};
+        unsigned* _cq_tail{nullptr};
+        io_uring_cqe* _cqes{nullptr};
+        unsigned _cq_mask{0};
+
+        unsigned _to_submit{0};
+        size_t _enters{0};
+        bool _flush_pending{false};
+
+        event_ptr _cq_ev;
+        event_ptr _flush_ev;
+
+        std::vector<op> _ops;
+        std::vector<uint32_t> _free;
+
+        // provided buffer ring, registered on first use: the ring of buffer descriptors shared with the kernel, and
+        // the buffers themselves (RECV_BUFFER_COUNT of RECV_BUFFER_SIZE bytes)
+        io_uring_buf* _buf_ring{nullptr};
+        size_t _buf_ring_len{0};
+        std::byte* _bufs{nullptr};
+        uint16_t _buf_tail{0};
+        uint16_t _bufs_out{0};  // taken out by `take_buffer`, not yet recycled
+        bool _bufs_failed{false};
+
+        // sockets whose multishot recv ended for want of buffers, re-armed as buffers come back
+        std::vector<ring_socket*> _starved;
+
+        // sockets with output queued during the current iteration, sent together by the end-of-iteration flush
+        std::vector<ring_socket*> _dirty;
+        std::vector<ring_socket*> _flushing;
+
+        bool _init(unsigned entries);
+
+        bool _setup_buffers();
+
+        // Appends buffer `bid` to the provided buffer ring
+        void _provide(uint16_t bid);
+
+        // Hands buffer `bid` back to the kernel, and re-arms receives that ran out of buffers
+        void _recycle(uint16_t bid);
+
+        void _mark_dirty(ring_socket& s);
+
+        void _forget(ring_socket& s);
+
+        io_uring_sqe* _get_sqe();
+
+        io_op_id _register(io_callback cb, void* user_arg);
+
+        void _release(uint32_t idx);
+
+        void _reap();
+
+        static void _cq_cb(evutil_socket_t fd, short, void* self);
+
+        static void _flush_cb(evutil_socket_t, short, void* self);
+    };
+
+    using ring_read_cb = void (*)(ring_socket& s, void* user_arg);
+
+    // Invoked with BEV_EVENT_EOF or BEV_EVENT_ERROR (errno is set) once the socket is done; no further callbacks follow
+    using ring_event_cb = void (*)(ring_socket& s, short events, void* user_arg);
+
+    /** Connected socket read and written through an io_ring instead of a bufferevent, for plaintext connections (or
+        sockets whose TLS records the kernel handles both ways).
+
+        Reads use a multishot recv into the ring's provided buffers: received bytes are appended to `input()` by
+        reference rather than copied, and each buffer goes back to the kernel once drained from there. Writes are
+        appended to an output buffer and sent at the end of the loop iteration, so everything written during one
+        iteration leaves in a single sendmsg, and the sends of every socket on the loop in a single io_uring_enter.
+
+        Must be created, used and destroyed on the loop thread, and destroyed before the ring.
+     */
+    class ring_socket
+    {
+        friend class io_ring;
+
+        ring_socket(io_ring& r, int fd, ring_read_cb read_cb, ring_event_cb event_cb, void* user_arg);
+
+      public:
+        // Takes ownership of `fd` unless it returns nullptr, i.e. if the ring cannot receive into provided buffers
+        static std::unique_ptr<ring_socket> make(
+            io_ring& r, int fd, ring_read_cb read_cb, ring_event_cb event_cb, void* user_arg);
+
+        ring_socket(const ring_socket&) = delete;
+        ring_socket& operator=(const ring_socket&) = delete;
+
+        ~ring_socket();
+
+        int fd() const { return _fd; }
+
+        // Received bytes not drained yet
+        evbuffer* input() { return _input.get(); }
+
+        // Queues `len` bytes for the end-of-iteration send
+        void write(const void* data, size_t len);
+
+        // Bytes written but not yet accepted by the kernel
+        size_t pending_output() const;
+
+      private:
+        io_ring& _ring;
+        int _fd;
+
+        ring_read_cb _read_cb;
+        ring_event_cb _event_cb;
+        void* _user_arg;
+
+        std::unique_ptr<evbuffer, deleters::_evbuffer> _input;
+
+        // bytes written since the last send, and those of the send in flight
+        std::unique_ptr<evbuffer, deleters::_evbuffer> _output;
+        std::unique_ptr<evbuffer, deleters::_evbuffer> _sending;
+
+        std::array<iovec, SEND_IOVECS> _iov{};
+        msghdr _msg{};
+
+        io_op_id _recv_op{0};
+        io_op_id _send_op{0};
+        bool _dirty{false};
+        bool _done{false};
+
+        void _arm_recv();
+
+        // Sends whatever is queued, unless a send is already in flight; called by the ring's flush
+        void _send();
+
+        void _fail(short events, int err);
+
+        static void _recv_cb(int res, uint32_t flags, void* self);
+
+        static void _send_cb(int res, uint32_t flags, void* self);
+    };
+
+#else
+
+    // Placeholder so that event_loop can hold a (always null) ring when built without io_uring support
+    class io_ring
+    {};
+
+#endif
+}  //  namespace wshttp
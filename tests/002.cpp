@@ -0,0 +1,1073 @@
+#include "utils.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace wshttp
+{
+    // Drives a timer wheel by hand, waking it for each tick it asks for the way its libevent timer would; the tick is
+    // long enough that the clock never moves the wheel on its own. Loop thread only.
+    struct timer_wheel_tester
+    {
+        std::shared_ptr<timer_wheel> wheel;
+        uint64_t now{0};  // tick the wheel was last woken for
+
+        explicit timer_wheel_tester(event_loop& l) : wheel{timer_wheel::make(l, l.loop(), 1h)} {}
+
+        void at(uint64_t tick, Job f, uint64_t interval = 0)
+        {
+            wheel->_schedule(wheel->_origin + wheel->_tick * tick, std::move(f), wheel->_tick * interval);
+        }
+
+        void run_until(uint64_t tick)
+        {
+            for (uint64_t due; wheel->size() > 0 and (due = wheel->_next_due()) <= tick;)
+                wheel->_advance_to(now = due);
+
+            wheel->_advance_to(now = tick);
+        }
+    };
+
+    // Buffers body chunks as a stream does on receiving DATA, each borrowing from one shared block of input, and drops
+    // them as `stream::consume` does. Loop thread only.
+    struct recv_buffer_tester
+    {
+        recv_buffer body;
+        input_block_ptr block{evbuffer_new(), deleters::_evbuffer{}};
+
+        explicit recv_buffer_tester(event_loop& l) : body{l} {}
+
+        void push(std::string_view s)
+        {
+            body.push({block, uspan{reinterpret_cast<const unsigned char*>(s.data()), s.size()}});
+        }
+
+        void close() { body.close(); }
+
+        size_t pop(size_t n) { return body.pop(n); }
+    };
+}  //  namespace wshttp
+
+namespace wshttp::test
+{
+    static task<int> add_later(event_loop& loop, int a, int b)
+    {
+        co_await loop.sleep(5ms);
+        co_return a + b;
+    }
+
+    static task<int> add_twice(event_loop& loop, int a, int b)
+    {
+        auto x = co_await add_later(loop, a, b);
+        auto y = co_await add_later(loop, a, b);
+        co_return x + y;
+    }
+
+    static task<void> throw_later(event_loop& loop)
+    {
+        co_await loop.sleep(1ms);
+        throw std::runtime_error{"from a task"};
+    }
+
+    static task<std::thread::id> hop(event_loop& loop)
+    {
+        co_await loop.resume_on();
+        co_return std::this_thread::get_id();
+    }
+
+    static task<void> flow(event_loop& loop, std::atomic<int>& done, int ms)
+    {
+        co_await loop.sleep(std::chrono::milliseconds{ms});
+        co_await loop.sleep(std::chrono::milliseconds{ms});
+        ++done;
+    }
+
+    static task<std::vector<int>> drain(event_loop& loop)
+    {
+        async_channel<int> ch{loop};
+        std::vector<int> out;
+
+        for (int i = 1; i <= 3; ++i)
+            loop.call_later(std::chrono::milliseconds{i * 5}, [&ch, i] { ch.push(i); });
+        loop.call_later(20ms, [&ch] { ch.close(); });
+
+        while (auto v = co_await ch.next())
+            out.push_back(*v);
+
+        co_return out;
+    }
+
+    // Coroutine that runs eagerly up to its first suspension, and is destroyed with its owner wherever it is
+    struct eager
+    {
+        struct promise_type
+        {
+            eager get_return_object() { return eager{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        std::coroutine_handle<promise_type> h;
+
+        explicit eager(std::coroutine_handle<promise_type> h) : h{h} {}
+        eager(eager&& e) noexcept : h{std::exchange(e.h, nullptr)} {}
+
+        ~eager()
+        {
+            if (h)
+                h.destroy();
+        }
+    };
+
+    static eager sleep_then(event_loop& loop, std::atomic<bool>& resumed)
+    {
+        co_await loop.sleep(10ms);
+        resumed = true;
+    }
+
+    static eager receive_into(async_channel<int>& ch, std::optional<int>& out)
+    {
+        out = co_await ch.next();
+    }
+
+    static eager wait_then(async_latch<bool>& l, std::atomic<bool>& resumed)
+    {
+        co_await l.wait();
+        resumed = true;
+    }
+
+    static eager wait_readable(recv_buffer& b, std::optional<bool>& out)
+    {
+        out = co_await b.readable();
+    }
+
+    TEST_CASE("002: MPSC queue", "[002][queue]")
+    {
+        SECTION("Single producer FIFO, including overflow")
+        {
+            mpsc_queue<int> q{8};
+            REQUIRE(q.capacity() == 8);
+
+            for (int i = 0; i < 20; ++i)
+                q.push(i);
+
+            std::vector<int> out;
+            while (out.size() < 20)
+                q.drain([&](int& i) { out.push_back(i); });
+
+            for (int i = 0; i < 20; ++i)
+                CHECK(out[i] == i);
+
+            CHECK(q.empty());
+        }
+
+        SECTION("Bounded drains keep FIFO order across the overflow")
+        {
+            mpsc_queue<int> q{4};
+
+            for (int i = 0; i < 10; ++i)
+                q.push(i);
+
+            std::vector<int> out;
+            while (out.size() < 6)
+                q.drain([&](int& i) { out.push_back(i); }, 3);
+
+            // the overflow has been taken over but not fully run; fresh pushes go behind it
+            q.push(10);
+            q.push(11);
+
+            while (out.size() < 12)
+                q.drain([&](int& i) { out.push_back(i); }, 3);
+
+            for (int i = 0; i < 12; ++i)
+                CHECK(out[i] == i);
+
+            CHECK(q.empty());
+        }
+
+        SECTION("Multiple producers preserve per-producer order")
+        {
+            constexpr int producers = 4, per_producer = 50'000;
+
+            mpsc_queue<std::pair<int, int>> q{256};
+            std::vector<std::thread> threads;
+
+            for (int p = 0; p < producers; ++p)
+                threads.emplace_back([&q, p] {
+                    for (int i = 0; i < per_producer; ++i)
+                        q.push(p, i);
+                });
+
+            std::array<int, producers> next{};
+            int received{0};
+            bool ordered{true};
+
+            while (received < producers * per_producer)
+                received += q.drain([&](std::pair<int, int>& v) {
+                    ordered &= v.second == next[v.first]++;
+                });
+
+            for (auto& t : threads)
+                t.join();
+
+            CHECK(ordered);
+            CHECK(q.empty());
+        }
+    }
+
+    TEST_CASE("002: Inline job", "[002][job]")
+    {
+        auto counter = std::make_shared<int>(0);
+
+        Job a{[counter] { ++*counter; }};
+        REQUIRE(a);
+
+        a();
+        CHECK(*counter == 1);
+
+        Job b{std::move(a)};
+        CHECK_FALSE(a);
+        REQUIRE(b);
+
+        b();
+        CHECK(*counter == 2);
+
+        b = nullptr;
+        CHECK_FALSE(b);
+        CHECK(counter.use_count() == 1);
+
+        // move-only captures are fine
+        auto owned = std::make_unique<int>(7);
+        Job c{[p = std::move(owned), counter] { *counter += *p; }};
+        c();
+        CHECK(*counter == 9);
+    }
+
+    TEST_CASE("002: Cross-thread call_get", "[002][call_get]")
+    {
+        auto loop = event_loop::make();
+
+        CHECK(loop->call_get([] { return 42; }) == 42);
+
+        auto s = loop->call_get([] { return std::string(100, 'x'); });
+        CHECK(s.size() == 100);
+
+        int side{0};
+        loop->call_get([&] { side = 7; });
+        CHECK(side == 7);
+
+        CHECK_THROWS_AS(loop->call_get([]() -> int { throw std::runtime_error{"from the loop"}; }), std::runtime_error);
+
+        // the loop survives a throwing job
+        CHECK(loop->call_get([] { return 1; }) == 1);
+    }
+
+    TEST_CASE("002: Budgeted job queue", "[002][jobs]")
+    {
+        auto loop = event_loop::make();
+        loop->set_job_budget(4);
+
+        std::mutex m;
+        std::vector<std::string> order;
+
+        auto record = [&](std::string s) {
+            std::lock_guard lock{m};
+            order.push_back(std::move(s));
+        };
+
+        // queue everything from the loop thread itself, so it is all picked up by the same wakeup
+        loop->call_get([&] {
+            loop->call_soon([&] { record("bg"); }, job_prio::background);
+            for (int i = 0; i < 10; ++i)
+                loop->call_soon([&, i] { record("job{}"_format(i)); });
+        });
+
+        // jobs left over past the budget still run, in order, once the loop comes back around
+        loop->call_get([] {});
+
+        std::lock_guard lock{m};
+        REQUIRE(order.size() == 11);
+
+        // the background job only got its guaranteed share after the first budgeted batch of latency jobs
+        CHECK(order[4] == "bg");
+        order.erase(order.begin() + 4);
+        for (int i = 0; i < 10; ++i)
+            CHECK(order[i] == "job{}"_format(i));
+    }
+
+    TEST_CASE("002: Background jobs wait for earlier jobs", "[002][jobs]")
+    {
+        auto loop = event_loop::make();
+        loop->set_job_budget(4);
+
+        std::vector<std::string> order;
+
+        std::promise<void> deleted;
+
+        struct tracked
+        {
+            std::vector<std::string>& order;
+            std::promise<void>& deleted;
+
+            ~tracked()
+            {
+                order.push_back("deleted");
+                deleted.set_value();
+            }
+        };
+
+        auto* obj = new tracked{order, deleted};
+
+        // hold the loop up, so that everything below lands in a single wakeup, well past the budget
+        std::promise<void> hold;
+        loop->call_soon([f = hold.get_future().share()] { f.wait(); });
+
+        for (int i = 0; i < 20; ++i)
+            loop->call_soon([obj, i] { obj->order.push_back("job{}"_format(i)); });
+
+        // as `loop_deleter` drops the last reference to an object from off the loop
+        loop->call_soon([obj] { delete obj; }, job_prio::background);
+
+        hold.set_value();
+        deleted.get_future().wait();
+
+        REQUIRE(order.size() == 21);
+        CHECK(order.back() == "deleted");
+        for (int i = 0; i < 20; ++i)
+            CHECK(order[i] == "job{}"_format(i));
+    }
+
+    TEST_CASE("002: Loop instrumentation", "[002][stats]")
+    {
+        auto loop = event_loop::make();
+        auto before = loop->stats();
+
+        // job timings are sampled, one in every JOB_SAMPLE_INTERVAL per posting thread
+        for (uint32_t i = 0; i < 20 * detail::JOB_SAMPLE_INTERVAL; ++i)
+            loop->call_soon([] { std::this_thread::sleep_for(10us); });
+        loop->call_get([] {});
+
+        std::atomic<bool> fired{false};
+        loop->call_later(5ms, [&] { fired = true; });
+        while (not fired)
+            std::this_thread::sleep_for(1ms);
+
+        auto s = loop->stats() - before;
+
+        CHECK(s.job_run.count >= 20);
+        CHECK(s.job_wait.count == s.job_run.count);
+        CHECK(s.job_run.percentile(0.5) >= 10'000);  // nanoseconds
+        CHECK(s.job_run.max >= s.job_run.percentile(0.99));
+        CHECK(s.queue_depth.count > 0);
+        CHECK(s.timer_lag.count == 1);
+        CHECK(s.callback.count > 0);
+        CHECK(s.iteration.count > 0);
+        CHECK(s.iteration.sum >= s.job_run.sum);
+    }
+
+    TEST_CASE("002: Busy polling event loop", "[002][busy_poll]")
+    {
+        auto loop = event_loop::make(std::nullopt, busy_poll_config{.min_spin = 5us, .max_spin = 100us});
+
+        CHECK(loop->call_get([] { return 42; }) == 42);
+
+        // jobs posted while the loop spins are picked up without a waker signal, as are timers once it blocks again
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 100; ++i)
+            loop->call_soon([&] { ++ran; });
+        loop->call_get([] {});
+        CHECK(ran == 100);
+
+        std::atomic<bool> fired{false};
+        loop->call_later(20ms, [&] { fired = true; });
+        while (not fired)
+            std::this_thread::sleep_for(1ms);
+
+        // and after idling past the spin window, a plain post still wakes it
+        std::this_thread::sleep_for(5ms);
+        CHECK(loop->call_get([] { return 7; }) == 7);
+
+        CHECK(loop->stats().iteration.count > 0);
+
+        CHECK_THROWS_AS(
+            event_loop::make(std::nullopt, busy_poll_config{.min_spin = 10us, .max_spin = 5us}),
+            std::invalid_argument);
+    }
+
+    TEST_CASE("002: Coroutines", "[002][coro]")
+    {
+        auto loop = event_loop::make();
+
+        SECTION("Tasks compose and return values")
+        {
+            CHECK(loop->block_on(add_later(*loop, 2, 3)) == 5);
+            CHECK(loop->block_on(add_twice(*loop, 2, 3)) == 10);
+        }
+
+        SECTION("Exceptions propagate to the awaiter")
+        {
+            CHECK_THROWS_AS(loop->block_on(throw_later(*loop)), std::runtime_error);
+        }
+
+        SECTION("resume_on continues on the loop thread")
+        {
+            CHECK(loop->block_on(hop(*loop)) != std::this_thread::get_id());
+        }
+
+        SECTION("Thousands of concurrent flows on one loop")
+        {
+            constexpr int n{5'000};
+            std::atomic<int> done{0};
+
+            for (int i = 0; i < n; ++i)
+                loop->spawn(flow(*loop, done, 1 + i % 20));
+
+            while (done < n)
+                std::this_thread::sleep_for(5ms);
+        }
+
+        SECTION("Channels deliver values in order, then close")
+        {
+            CHECK(loop->block_on(drain(*loop)) == std::vector<int>{1, 2, 3});
+        }
+
+        SECTION("Destroying a sleeping coroutine cancels its timer")
+        {
+            std::atomic<bool> resumed{false};
+
+            loop->call_get([&] { auto e = sleep_then(*loop, resumed); });
+
+            std::this_thread::sleep_for(50ms);
+            CHECK_FALSE(resumed);
+        }
+
+        SECTION("Destroying a suspended receiver or waiter takes it off the channel or latch")
+        {
+            std::optional<int> dead, alive;
+            std::atomic<bool> resumed{false};
+
+            auto got = loop->call_get([&] {
+                async_channel<int> ch{*loop};
+                async_latch<bool> l{*loop}, woken{*loop};
+
+                // destroyed while suspended: the value stays queued for the next receiver
+                {
+                    auto r = receive_into(ch, dead);
+                }
+                ch.push(1);
+                {
+                    auto r = receive_into(ch, alive);
+                }
+
+                // destroyed once woken, before its resumption comes around
+                {
+                    auto r = receive_into(ch, dead);
+                    ch.push(2);
+                }
+
+                {
+                    auto w = wait_then(l, resumed);
+                }
+                l.set(true);
+
+                {
+                    auto w = wait_then(woken, resumed);
+                    woken.set(true);
+                }
+
+                return alive;
+            });
+
+            // let the loop run any resumption that was left behind
+            loop->call_get([] {});
+            std::this_thread::sleep_for(20ms);
+
+            CHECK(got == 1);
+            CHECK_FALSE(dead);
+            CHECK_FALSE(resumed);
+        }
+
+        SECTION("Empty tasks cannot be awaited")
+        {
+            CHECK_THROWS_AS(loop->block_on(task<int>{}), std::invalid_argument);
+            CHECK_THROWS_AS(loop->spawn(task<void>{}), std::invalid_argument);
+        }
+    }
+
+    TEST_CASE("002: Single-threaded event loop", "[002][nolock]")
+    {
+        auto loop = event_loop::make(std::nullopt, std::nullopt, loop_mode::single_threaded);
+
+        // the mode falls back to locking in builds without the eventfd waker
+        REQUIRE(loop->lock_free() == event_loop::supports_lock_free());
+
+        // other threads still reach it through the job queue and the eventfd waker, never the event base itself
+        std::atomic<int> ran{0};
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t)
+            producers.emplace_back([&] {
+                for (int i = 0; i < 1000; ++i)
+                    loop->call_soon([&] { ++ran; });
+            });
+        for (auto& t : producers)
+            t.join();
+
+        CHECK(loop->call_get([&] { return ran.load(); }) == 4000);
+
+        std::atomic<int> ticks{0};
+        auto t = loop->call_every(5ms, [&] { ++ticks; });
+        while (ticks < 3)
+            std::this_thread::sleep_for(1ms);
+        CHECK(t->stop());
+
+        auto pool = event_loop_pool::make(2, false, std::nullopt, loop_mode::single_threaded);
+        for (auto& l : *pool)
+            CHECK(l->mode() == loop->mode());
+
+        // endpoints asking for one take whichever mode the build gave the loop, as `endpoint::make` does with the loop
+        // it makes; any other loop handed in has to match
+        auto creds = make_test_creds(fs::temp_directory_path(), "wshttp-002");
+        CHECK_NOTHROW(endpoint::make(loop, creds, loop_mode::single_threaded));
+
+        if (event_loop::supports_lock_free())
+        {
+            auto locked = event_loop::make();
+            CHECK_THROWS_AS(endpoint::make(locked, creds, loop_mode::single_threaded), std::invalid_argument);
+            CHECK_THROWS_AS(endpoint::make(loop, creds, loop_mode::threadsafe), std::invalid_argument);
+        }
+    }
+
+    TEST_CASE("002: Event loop pool", "[002][pool]")
+    {
+        auto pool = event_loop_pool::make(3);
+        REQUIRE(pool->size() == 3);
+
+        std::vector<std::thread::id> ids;
+        for (auto& l : *pool)
+            ids.push_back(l->call_get([] { return std::this_thread::get_id(); }));
+
+        std::sort(ids.begin(), ids.end());
+        CHECK(std::unique(ids.begin(), ids.end()) == ids.end());
+
+        CHECK(pool->next() == pool->primary());
+        CHECK(pool->next() == (*pool)[1]);
+        CHECK(pool->next() == (*pool)[2]);
+        CHECK(pool->next() == pool->primary());
+
+#ifdef __linux__
+        // pinning is best-effort: a core outside this process's cpuset (taskset, containers) is left unpinned
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        REQUIRE(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+        auto cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < pool->size(); ++i)
+        {
+            auto core = static_cast<int>(i % cores);
+            if (not CPU_ISSET(core, &allowed))
+                continue;
+
+            auto [pinned, cpu] = (*pool)[i]->call_get([] {
+                cpu_set_t mask;
+                CPU_ZERO(&mask);
+                pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask);
+                return std::pair{CPU_COUNT(&mask), sched_getcpu()};
+            });
+
+            CHECK(pinned == 1);
+            CHECK(cpu == core);
+        }
+#endif
+    }
+
+    TEST_CASE("002: Timer wheel", "[002][timers]")
+    {
+        auto loop = event_loop::make();
+
+        SECTION("One-shot timers fire in deadline order, never early")
+        {
+            std::mutex m;
+            std::vector<int> order;
+            std::atomic<int> fired{0};
+            auto start = detail::get_time();
+            std::atomic<bool> early{false};
+
+            // 300ms and 600ms land in level 1 of the fine wheel and have to be cascaded down
+            for (int ms : {600, 20, 300, 5, 80})
+                loop->call_later(std::chrono::milliseconds{ms}, [&, ms] {
+                    early = early or detail::get_time() - start < std::chrono::milliseconds{ms};
+                    std::lock_guard lock{m};
+                    order.push_back(ms);
+                    ++fired;
+                });
+
+            while (fired < 5)
+                std::this_thread::sleep_for(5ms);
+
+            CHECK_FALSE(early);
+            CHECK(order == std::vector<int>{5, 20, 80, 300, 600});
+        }
+
+        SECTION("Cancelled timers do not fire")
+        {
+            std::atomic<int> fired{0};
+
+            auto a = loop->call_later(30ms, [&] { fired += 1; });
+            auto b = loop->call_later(30ms, [&] { fired += 10; }, timer_res::coarse);
+            auto c = loop->call_later(10ms, [&] { fired += 100; });
+
+            CHECK(a.pending());
+            CHECK(a.cancel());
+            CHECK_FALSE(a.cancel());
+            CHECK(b.cancel());
+
+            std::this_thread::sleep_for(200ms);
+
+            CHECK(fired == 100);
+            CHECK_FALSE(c.pending());
+            CHECK_FALSE(c.cancel());
+        }
+
+        SECTION("Scheduling and cancelling off the loop never wait for it")
+        {
+            std::atomic<int> fired{0};
+
+            // hold the loop up: neither timer is on the wheel yet when its handle comes back
+            std::promise<void> hold;
+            loop->call_soon([f = hold.get_future().share()] { f.wait(); });
+
+            auto a = loop->call_later(10ms, [&] { fired += 1; });
+            auto b = loop->call_later(10ms, [&] { fired += 10; });
+
+            CHECK(a.pending());
+            CHECK(a.cancel());
+            CHECK_FALSE(a.pending());
+            CHECK_FALSE(a.cancel());
+
+            hold.set_value();
+
+            while (fired == 0)
+                std::this_thread::sleep_for(1ms);
+
+            std::this_thread::sleep_for(50ms);
+            CHECK(fired == 10);
+            CHECK_FALSE(b.pending());
+            CHECK_FALSE(b.cancel());
+        }
+
+        SECTION("Timers scheduled from another loop")
+        {
+            auto other = event_loop::make();
+            std::promise<void> fired;
+
+            // the other loop goes on with its own work right away; the timer lands on this loop's wheel
+            auto h = other->call_get([&] { return loop->call_later(5ms, [&] { fired.set_value(); }); });
+            CHECK(fired.get_future().wait_for(1s) == std::future_status::ready);
+            CHECK_FALSE(h.pending());
+        }
+
+        SECTION("Repeating timers can be stopped and restarted")
+        {
+            std::atomic<int> ticks{0};
+
+            auto t = loop->call_every(5ms, [&] { ++ticks; });
+            REQUIRE(t->is_running());
+
+            while (ticks < 5)
+                std::this_thread::sleep_for(1ms);
+
+            CHECK(t->stop());
+            CHECK_FALSE(t->is_running());
+
+            // stopping takes effect once the loop gets to it
+            loop->call_get([] {});
+            auto stopped_at = ticks.load();
+            std::this_thread::sleep_for(30ms);
+            CHECK(ticks == stopped_at);
+
+            CHECK(t->start());
+            while (ticks < stopped_at + 3)
+                std::this_thread::sleep_for(1ms);
+        }
+
+        SECTION("Timers waiting on a block boundary cascade are not held back by level 0")
+        {
+            loop->call_get([&] {
+                timer_wheel_tester t{*loop};
+                std::map<char, uint64_t> fired;
+
+                // A goes into level 1, and has to come down when the cursor reaches 256 while C already sits in level 0
+                t.at(280, [&] { fired['A'] = t.now; });
+                t.run_until(100);
+                t.at(255, [&] { fired['D'] = t.now; });
+                t.at(300, [&] { fired['C'] = t.now; });
+                t.run_until(1000);
+
+                CHECK(fired == std::map<char, uint64_t>{{'A', 280}, {'C', 300}, {'D', 255}});
+            });
+        }
+
+        SECTION("Timers fire on their own tick through every level's rollover")
+        {
+            loop->call_get([&] {
+                timer_wheel_tester t{*loop};
+                std::mt19937_64 rng{2};
+                size_t fired{0}, late{0};
+
+                // deadlines from a tick to a few level 2 rotations out, scheduled as the cursor moves along
+                for (uint64_t step = 1; step <= 200; ++step)
+                {
+                    for (int i = 0; i < 20; ++i)
+                    {
+                        auto due = t.now + 1 + rng() % (uint64_t{1} << (rng() % 19));
+                        t.at(due, [&, due] {
+                            late += t.now != due;
+                            ++fired;
+                        });
+                    }
+                    t.run_until(t.now + rng() % 2000);
+                }
+
+                t.run_until(t.now + (uint64_t{1} << 19));
+
+                CHECK(fired == 4000);
+                CHECK(late == 0);
+                CHECK(t.wheel->size() == 0);
+            });
+        }
+
+        SECTION("Repeating timers keep their period across rotations")
+        {
+            loop->call_get([&] {
+                timer_wheel_tester t{*loop};
+                std::map<uint64_t, std::vector<uint64_t>> fired;
+
+                // periods either side of a level 0 rotation, a listening endpoint's ticket key check, and those of a
+                // node's idle session reaper on the coarse wheel, at the shortest and the default idle timeouts
+                std::vector<uint64_t> periods{7, 255, 256, 257, 3000, 20000, 1s / COARSE_TIMER_TICK};
+                for (auto idle : {400ms, pool_config{}.idle_timeout})
+                    periods.push_back(pool_config{.idle_timeout = idle}.reap_interval() / COARSE_TIMER_TICK);
+
+                for (auto every : periods)
+                    t.at(t.now + 50 + every, [&, every] { fired[every].push_back(t.now); }, every);
+
+                uint64_t until{5 * 16384};
+                t.run_until(until);
+
+                REQUIRE(fired.size() == periods.size());
+
+                for (auto& [every, ticks] : fired)
+                {
+                    INFO("every " << every << " ticks");
+                    REQUIRE(ticks.size() == (until - 50) / every);
+                    for (size_t i = 0; i < ticks.size(); ++i)
+                        CHECK(ticks[i] == 50 + (i + 1) * every);
+                }
+            });
+        }
+
+        SECTION("Timers started partway into a rotation carry across it")
+        {
+            // the fine wheel's level 0 turns over every 256ms from the loop's creation; start well into the first
+            // rotation, so that these deadlines wrap to level 0 slots behind the cursor
+            auto fresh = event_loop::make();
+            std::this_thread::sleep_for(200ms);
+
+            std::atomic<bool> fired{false};
+            std::atomic<int> ticks{0}, lone{0};
+            auto start = detail::get_time();
+
+            fresh->call_later(100ms, [&] { fired = true; });
+
+            auto t = fresh->call_every(7ms, [&] { ++ticks; });
+            auto u = fresh->call_every(256ms, [&] { ++lone; });
+
+            while ((not fired or ticks < 100) and detail::get_time() - start < 5s)
+                std::this_thread::sleep_for(5ms);
+
+            CHECK(fired);
+            CHECK(ticks >= 100);
+
+            // a repeating timer a full rotation apart lands back in the slot it fires from, and must still wait it out
+            CHECK(lone <= (detail::get_time() - start) / 256ms);
+
+            t->stop();
+            u->stop();
+        }
+    }
+
+    TEST_CASE("002: Stream body buffer", "[002][body]")
+    {
+        auto loop = event_loop::make();
+
+        SECTION("Bytes are peeked and popped across chunk boundaries")
+        {
+            loop->call_get([&] {
+                recv_buffer_tester t{*loop};
+                t.push("hello");
+                t.push(" wide");
+                t.push(" world");
+
+                auto& b = t.body;
+                REQUIRE(b.size() == 16);
+                CHECK(b.chunks().size() == 3);
+
+                auto as_string = [](const iovec& v) {
+                    return std::string{static_cast<const char*>(v.iov_base), v.iov_len};
+                };
+
+                std::array<iovec, 2> out;
+                REQUIRE(b.peek(out) == 2);
+                CHECK(as_string(out[0]) == "hello");
+                CHECK(as_string(out[1]) == " wide");
+
+                // a pop ending mid-chunk leaves the rest of that chunk in front
+                CHECK(t.pop(7) == 7);
+                CHECK(b.size() == 9);
+                REQUIRE(b.peek(out) == 2);
+                CHECK(as_string(out[0]) == "ide");
+                CHECK(as_string(out[1]) == " world");
+
+                // one ending on a boundary takes the whole chunk off
+                CHECK(t.pop(3) == 3);
+                CHECK(b.chunks().size() == 1);
+                CHECK(b.peek(out) == 1);
+                CHECK(as_string(out[0]) == " world");
+
+                // popping past the end only drops what is there, and lets go of the block
+                CHECK(t.pop(100) == 6);
+                CHECK(b.empty());
+                CHECK(b.peek(out) == 0);
+                CHECK(t.pop(1) == 0);
+                CHECK(t.block.use_count() == 1);
+            });
+        }
+
+        SECTION("Waiting for bytes resumes on a push, or on close")
+        {
+            auto t = loop->call_get([&] { return std::make_unique<recv_buffer_tester>(*loop); });
+            std::optional<bool> got;
+
+            std::optional<eager> waiting;
+
+            loop->call_get([&] { waiting.emplace(wait_readable(t->body, got)); });
+            loop->call_get([] {});
+            CHECK_FALSE(got);
+
+            // the waiter is resumed from a loop job of its own, not from within the push
+            loop->call_get([&] {
+                t->push("data");
+                CHECK_FALSE(got);
+            });
+            loop->call_get([] {});
+            CHECK(got == true);
+
+            // buffered bytes are ready right away, even once closed
+            loop->call_get([&] {
+                t->close();
+                got.reset();
+                waiting.emplace(wait_readable(t->body, got));
+                CHECK(got == true);
+            });
+
+            // once drained, a closed buffer has nothing left to wait for
+            loop->call_get([&] {
+                t->pop(4);
+                got.reset();
+                waiting.emplace(wait_readable(t->body, got));
+                CHECK(got == false);
+            });
+
+            // an open one resumes empty-handed when it closes, or when the stream goes away
+            for (bool destroy : {false, true})
+            {
+                loop->call_get([&] {
+                    t = std::make_unique<recv_buffer_tester>(*loop);
+                    got.reset();
+                    waiting.emplace(wait_readable(t->body, got));
+                });
+                loop->call_get([&] { destroy ? t.reset() : t->close(); });
+                loop->call_get([] {});
+                CHECK(got == false);
+            }
+
+            loop->call_get([&] {
+                waiting.reset();
+                t.reset();
+            });
+        }
+
+        SECTION("A waiter destroyed while suspended is dropped from the buffer")
+        {
+            loop->call_get([&] {
+                recv_buffer_tester t{*loop};
+                std::optional<bool> got;
+
+                {
+                    auto waiting = wait_readable(t.body, got);
+                }
+
+                t.push("late");
+                CHECK_FALSE(got);
+            });
+
+            loop->call_get([] {});
+        }
+    }
+
+    TEST_CASE("002: Request body provider", "[002][request]")
+    {
+        // header literals go on the wire without their terminating NUL
+        CHECK(req::fields::status.size() == 7);
+        CHECK(defaults::ALPN == uspan{reinterpret_cast<const unsigned char*>("h2"), 2});
+
+        std::string payload(100, 'x');
+        payload.back() = 'y';
+        auto body = request::from(payload);
+
+        std::array<uint8_t, 64> buf;
+        std::string out;
+        bool eof{false};
+
+        CHECK(body(buf, eof) == 64);
+        CHECK_FALSE(eof);
+        out.append(reinterpret_cast<const char*>(buf.data()), 64);
+
+        CHECK(body(buf, eof) == 36);
+        CHECK(eof);
+        out.append(reinterpret_cast<const char*>(buf.data()), 36);
+
+        CHECK(out == payload);
+    }
+
+    // Stand-in for an outbound session, exposing just what the node's pool policy looks at
+    struct fake_session
+    {
+        size_t streams{0};
+        uint32_t capacity{100};
+        bool open{true};
+        std::chrono::steady_clock::time_point active{};
+
+        size_t active_streams() const { return streams; }
+        uint32_t stream_capacity() const { return capacity; }
+        bool accepts_streams() const { return open; }
+        std::chrono::steady_clock::time_point last_active() const { return active; }
+    };
+
+    TEST_CASE("002: Outbound session pool", "[002][pool]")
+    {
+        auto make = [](size_t streams, uint32_t capacity, bool open = true) {
+            return std::make_shared<fake_session>(fake_session{streams, capacity, open});
+        };
+
+        SECTION("Requests go to the least loaded session below its stream limit")
+        {
+            std::vector<std::shared_ptr<fake_session>> pool{make(5, 10), make(2, 10), make(1, 10, false), make(3, 10)};
+
+            auto [use, fallback] = detail::choose_session(pool, 4);
+            CHECK(use == pool[1]);
+            CHECK(fallback == pool[1]);
+
+            // a session at its peer's limit is passed over, however lightly loaded
+            pool[1]->capacity = 2;
+            CHECK(detail::choose_session(pool, 4).use == pool[3]);
+        }
+
+        SECTION("A full pool opens another connection while it has room")
+        {
+            std::vector<std::shared_ptr<fake_session>> pool{make(10, 10), make(8, 8)};
+
+            auto [use, fallback] = detail::choose_session(pool, 4);
+            CHECK(use == nullptr);
+            CHECK(fallback == pool[1]);
+        }
+
+        SECTION("A full pool at its limit falls back to the least loaded session")
+        {
+            std::vector<std::shared_ptr<fake_session>> pool{make(12, 10), make(9, 8)};
+
+            auto [use, fallback] = detail::choose_session(pool, 2);
+            CHECK(use == pool[1]);
+            CHECK(fallback == pool[1]);
+        }
+
+        SECTION("A pool with no session accepting streams connects anew, even at its limit")
+        {
+            std::vector<std::shared_ptr<fake_session>> pool{make(0, 10, false), make(0, 10, false)};
+
+            auto [use, fallback] = detail::choose_session(pool, 2);
+            CHECK(use == nullptr);
+            CHECK(fallback == nullptr);
+        }
+
+        SECTION("Only sessions idle past the timeout are reaped")
+        {
+            auto now = std::chrono::steady_clock::now();
+
+            std::vector<std::shared_ptr<fake_session>> pool{make(0, 10), make(1, 10), make(0, 10), make(0, 10, false)};
+            pool[0]->active = now - 2s;
+            pool[1]->active = now - 2s;
+            pool[2]->active = now - 500ms;
+            pool[3]->active = now - 2s;
+
+            auto idle = detail::idle_sessions(pool, now, 1s);
+            REQUIRE(idle.size() == 1);
+            CHECK(idle[0] == pool[0]);
+
+            CHECK(detail::idle_sessions(pool, now, 100ms).size() == 2);
+        }
+    }
+
+    TEST_CASE("002: Session ticket keys", "[002][tickets]")
+    {
+        CHECK_THROWS_AS(ticket_keys::make(0s), std::invalid_argument);
+        CHECK_THROWS_AS(ticket_keys::make(1h, 1), std::invalid_argument);
+
+        auto keys = ticket_keys::make(1h, 3);
+        CHECK(keys->rotations() == 1);
+        CHECK(keys->ticket_lifetime() == 2h);
+
+        // the first key is fresh, so timers of endpoints sharing the set leave it be
+        CHECK_FALSE(keys->rotate_if_due());
+        CHECK(keys->rotations() == 1);
+
+        keys->rotate();
+        CHECK(keys->rotations() == 2);
+
+        auto quick = ticket_keys::make(1s);
+        std::this_thread::sleep_for(1100ms);
+
+        std::atomic<int> rotated{0};
+        std::vector<std::thread> timers;
+        for (int t = 0; t < 4; ++t)
+            timers.emplace_back([&] { rotated += quick->rotate_if_due(); });
+        for (auto& t : timers)
+            t.join();
+
+        CHECK(rotated == 1);
+        CHECK(quick->rotations() == 2);
+    }
+
+    TEST_CASE("002: Listening endpoints rotate ticket keys", "[002][tickets]")
+    {
+        auto keys = ticket_keys::make(1s);
+        auto creds = make_test_creds(fs::temp_directory_path(), "wshttp-002");
+        auto ep = endpoint::make(creds, tls_resumption{.keys = keys});
+
+        REQUIRE(ep->listen(0));
+
+        // the endpoint's first check, a second in, finds the key due; its later rotations are the wheel's business
+        auto start = detail::get_time();
+        while (keys->rotations() == 1 and detail::get_time() - start < 2500ms)
+            std::this_thread::sleep_for(20ms);
+
+        CHECK(keys->rotations() == 2);
+    }
+}  // namespace wshttp::test
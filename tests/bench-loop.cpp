@@ -0,0 +1,828 @@
+#include "utils.hpp"
+
+#ifdef WSHTTP_USE_IO_URING
+#include "uring.hpp"
+#endif
+
+#include <dlfcn.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <ctime>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace wshttp::bench
+{
+    // Calls made through the libc wrappers interposed below, from any thread; io_uring_enter goes through syscall(2)
+    // and is counted by the ring instead
+    static std::atomic<size_t> syscalls{0};
+
+    template <typename F>
+    static F next_symbol(const char* name)
+    {
+        return reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+    }
+}  //  namespace wshttp::bench
+
+// The syscalls libevent and the io_ring make on the loop thread, counted on their way to libc
+#define WSHTTP_COUNTED(ret, name, params, args, ...)                                                                  \
+    extern "C" ret name params __VA_ARGS__                                                                           \
+    {                                                                                                                  \
+        static auto next = wshttp::bench::next_symbol<ret(*) params>(#name);                                           \
+        wshttp::bench::syscalls.fetch_add(1, std::memory_order_relaxed);                                               \
+        return next args;                                                                                              \
+    }
+
+WSHTTP_COUNTED(int, epoll_wait, (int epfd, epoll_event* evs, int n, int timeout), (epfd, evs, n, timeout))
+WSHTTP_COUNTED(int, epoll_ctl, (int epfd, int op, int fd, epoll_event* ev), (epfd, op, fd, ev), noexcept)
+WSHTTP_COUNTED(ssize_t, read, (int fd, void* buf, size_t n), (fd, buf, n))
+WSHTTP_COUNTED(ssize_t, readv, (int fd, const iovec* iov, int n), (fd, iov, n))
+WSHTTP_COUNTED(ssize_t, write, (int fd, const void* buf, size_t n), (fd, buf, n))
+WSHTTP_COUNTED(ssize_t, writev, (int fd, const iovec* iov, int n), (fd, iov, n))
+WSHTTP_COUNTED(ssize_t, recv, (int fd, void* buf, size_t n, int flags), (fd, buf, n, flags))
+WSHTTP_COUNTED(ssize_t, send, (int fd, const void* buf, size_t n, int flags), (fd, buf, n, flags))
+WSHTTP_COUNTED(int, eventfd_read, (int fd, eventfd_t* value), (fd, value))
+
+#undef WSHTTP_COUNTED
+
+// evbuffer reads ask for FIONREAD first; every request libevent makes takes a single pointer argument
+extern "C" int ioctl(int fd, unsigned long req, ...) noexcept
+{
+    static auto next = wshttp::bench::next_symbol<int (*)(int, unsigned long, void*)>("ioctl");
+    wshttp::bench::syscalls.fetch_add(1, std::memory_order_relaxed);
+
+    va_list ap;
+    va_start(ap, req);
+    auto* arg = va_arg(ap, void*);
+    va_end(ap);
+
+    return next(fd, req, arg);
+}
+
+namespace wshttp::bench
+{
+    using clock = std::chrono::steady_clock;
+
+    // Reproduction of the previous `event_loop` job queue (mutex + std::queue, swapped out by the consumer), kept as
+    // the baseline to compare against
+    struct locked_queue
+    {
+        std::mutex m;
+        std::queue<Job> q;
+
+        void push(Job j)
+        {
+            std::lock_guard lock{m};
+            q.emplace(std::move(j));
+        }
+
+        size_t drain()
+        {
+            decltype(q) swapped;
+            {
+                std::lock_guard lock{m};
+                q.swap(swapped);
+            }
+            size_t n = swapped.size();
+            while (not swapped.empty())
+            {
+                swapped.front()();
+                swapped.pop();
+            }
+            return n;
+        }
+    };
+
+    // The previous job path as a whole: a `locked_queue` drained from a libevent event that producers activate from
+    // their own threads, which takes the (locked) event base's lock and wakes the loop through its notify pipe
+    struct locked_loop
+    {
+        locked_queue jobs;
+        std::unique_ptr<event_base, decltype(&event_base_free)> base{nullptr, event_base_free};
+        event_ptr waker;
+        std::thread thread;
+
+        locked_loop()
+        {
+            evthread_use_pthreads();
+            base.reset(event_base_new());
+
+            waker.reset(event_new(
+                base.get(),
+                -1,
+                0,
+                [](evutil_socket_t, short, void* self) { static_cast<locked_loop*>(self)->jobs.drain(); },
+                this));
+
+            thread = std::thread{[this] { event_base_loop(base.get(), EVLOOP_NO_EXIT_ON_EMPTY); }};
+
+            // a break requested before the loop starts would be lost
+            std::promise<void> started;
+            call_soon([&] { started.set_value(); });
+            started.get_future().wait();
+        }
+
+        ~locked_loop()
+        {
+            event_base_loopbreak(base.get());
+            thread.join();
+        }
+
+        void call_soon(Job j)
+        {
+            jobs.push(std::move(j));
+            event_active(waker.get(), 0, 0);
+        }
+    };
+
+    struct mpsc_adapter
+    {
+        mpsc_queue<Job> q;
+
+        void push(Job j) { q.push(std::move(j)); }
+
+        size_t drain()
+        {
+            return q.drain([](Job& j) { j(); });
+        }
+    };
+
+    static double mops(size_t n, clock::duration d)
+    {
+        return n / std::chrono::duration<double, std::micro>(d).count();
+    }
+
+    // Raw queue throughput: `producers` threads push `per_producer` jobs each while one thread drains
+    template <typename Q>
+    static double queue_throughput(size_t producers, size_t per_producer)
+    {
+        Q queue;
+        std::atomic<size_t> ran{0};
+        const size_t total = producers * per_producer;
+
+        auto start = clock::now();
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+            threads.emplace_back([&] {
+                for (size_t i = 0; i < per_producer; ++i)
+                    queue.push([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+            });
+
+        while (ran.load(std::memory_order_relaxed) < total)
+            if (queue.drain() == 0)
+                std::this_thread::yield();
+
+        auto elapsed = clock::now() - start;
+
+        for (auto& t : threads)
+            t.join();
+
+        return mops(total, elapsed);
+    }
+
+    // End-to-end throughput of `event_loop::call_soon` from `producers` threads until every job has run on the loop
+    static double loop_throughput(size_t producers, size_t per_producer)
+    {
+        auto loop = event_loop::make();
+        std::atomic<size_t> ran{0};
+        const size_t total = producers * per_producer;
+
+        auto start = clock::now();
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+            threads.emplace_back([&] {
+                for (size_t i = 0; i < per_producer; ++i)
+                    loop->call_soon([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+            });
+
+        for (auto& t : threads)
+            t.join();
+
+        while (ran.load(std::memory_order_acquire) < total)
+            std::this_thread::yield();
+
+        return mops(total, clock::now() - start);
+    }
+
+    // Burst latency: time from the first `call_soon` of a back-to-back burst until the last job of it has run
+    static double burst_latency(size_t burst, size_t rounds)
+    {
+        auto loop = event_loop::make();
+        double total{0};
+
+        for (size_t r = 0; r < rounds; ++r)
+        {
+            std::atomic<size_t> ran{0};
+
+            auto start = clock::now();
+            for (size_t i = 0; i < burst; ++i)
+                loop->call_soon([&ran] { ran.fetch_add(1, std::memory_order_release); });
+
+            while (ran.load(std::memory_order_acquire) < burst)
+                std::this_thread::yield();
+
+            total += std::chrono::duration<double, std::micro>(clock::now() - start).count();
+        }
+
+        return total / rounds;
+    }
+
+    // Wake latency: time from `call_soon` on an idle loop until the job starts executing
+    template <typename Loop>
+    static std::vector<double> wake_latency(Loop& loop, size_t samples)
+    {
+        std::vector<double> lat;
+        lat.reserve(samples);
+
+        for (size_t i = 0; i < samples; ++i)
+        {
+            std::atomic<bool> done{false};
+            clock::time_point ran_at;
+
+            auto posted_at = clock::now();
+            loop.call_soon([&] {
+                ran_at = clock::now();
+                done.store(true, std::memory_order_release);
+            });
+
+            while (not done.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            lat.push_back(std::chrono::duration<double, std::micro>(ran_at - posted_at).count());
+
+            // let the loop go back to sleep so every sample measures a cold wakeup
+            std::this_thread::sleep_for(50us);
+        }
+
+        std::sort(lat.begin(), lat.end());
+        return lat;
+    }
+
+    // Reproduction of the previous `event_loop::call_get` (promise/future pair per call), kept as the baseline
+    template <typename Callable, typename Ret = decltype(std::declval<Callable>()())>
+    static Ret promise_call_get(event_loop& loop, Callable&& f)
+    {
+        std::promise<Ret> prom;
+        auto fut = prom.get_future();
+
+        loop.call_soon([&f, &prom] {
+            try
+            {
+                if constexpr (!std::is_void_v<Ret>)
+                    prom.set_value(f());
+                else
+                {
+                    f();
+                    prom.set_value();
+                }
+            }
+            catch (...)
+            {
+                prom.set_exception(std::current_exception());
+            }
+        });
+
+        return fut.get();
+    }
+
+    // Round trip latency of a blocking cross-thread call onto the loop, returning a value
+    template <bool Promise>
+    static std::vector<double> call_get_latency(size_t samples)
+    {
+        auto loop = event_loop::make();
+        std::vector<double> lat;
+        lat.reserve(samples);
+
+        for (size_t i = 0; i < samples; ++i)
+        {
+            auto start = clock::now();
+
+            int r;
+            if constexpr (Promise)
+                r = promise_call_get(*loop, [i] { return static_cast<int>(i); });
+            else
+                r = loop->call_get([i] { return static_cast<int>(i); });
+
+            lat.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+
+            if (r != static_cast<int>(i))
+                throw std::runtime_error{"call_get returned the wrong value"};
+        }
+
+        std::sort(lat.begin(), lat.end());
+        return lat;
+    }
+
+    struct accept_result
+    {
+        double conns_per_sec;
+        size_t enters;
+    };
+
+    // Loopback clients that connect and immediately hang up, `conns` times in total across `clients` threads
+    static void run_clients(uint16_t port, size_t clients, size_t conns)
+    {
+        std::vector<std::thread> threads;
+
+        for (size_t c = 0; c < clients; ++c)
+            threads.emplace_back([=] {
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                addr.sin_port = htons(port);
+
+                for (size_t i = c; i < conns; i += clients)
+                {
+                    int fd = socket(AF_INET, SOCK_STREAM, 0);
+                    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+                        throw std::runtime_error{"connect failed: {}"_format(strerror(errno))};
+                    close(fd);
+                }
+            });
+
+        for (auto& t : threads)
+            t.join();
+    }
+
+    static uint16_t local_port(int fd)
+    {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        return ntohs(addr.sin_port);
+    }
+
+    // Accept throughput of a libevent evconnlistener on the loop, the path `listener` takes without io_uring
+    static accept_result evconn_accept(size_t clients, size_t conns)
+    {
+        auto loop = event_loop::make();
+        std::atomic<size_t> accepted{0};
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        auto* lev = loop->call_get([&] {
+            return evconnlistener_new_bind(
+                loop->loop().get(),
+                [](evconnlistener*, evutil_socket_t fd, sockaddr*, int, void* arg) {
+                    close(fd);
+                    static_cast<std::atomic<size_t>*>(arg)->fetch_add(1, std::memory_order_release);
+                },
+                &accepted,
+                LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE,
+                SOMAXCONN,
+                reinterpret_cast<sockaddr*>(&addr),
+                sizeof(addr));
+        });
+
+        auto start = clock::now();
+        run_clients(local_port(evconnlistener_get_fd(lev)), clients, conns);
+
+        while (accepted.load(std::memory_order_acquire) < conns)
+            std::this_thread::yield();
+
+        auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        loop->call_get([lev] { evconnlistener_free(lev); });
+
+        return {conns / elapsed, 0};
+    }
+
+#ifdef WSHTTP_USE_IO_URING
+    // Accept throughput of a multishot accept on an io_ring riding the same loop
+    struct ring_acceptor
+    {
+        io_ring* ring{nullptr};
+        int fd{-1};
+        io_op_id op{0};
+        std::atomic<size_t> accepted{0};
+
+        static void accept_cb(int res, uint32_t flags, void* user_arg)
+        {
+            auto& a = *static_cast<ring_acceptor*>(user_arg);
+
+            if (res >= 0)
+            {
+                close(res);
+                a.accepted.fetch_add(1, std::memory_order_release);
+            }
+
+            // as the listener does, re-arm whenever the kernel ends the multishot accept
+            if (not(flags & IORING_CQE_F_MORE))
+                a.op = a.ring->accept_multishot(a.fd, accept_cb, &a);
+        }
+    };
+
+    static accept_result uring_accept(size_t clients, size_t conns)
+    {
+        auto loop = event_loop::make();
+        auto ring = loop->call_get([&] { return io_ring::make(*loop); });
+        if (not ring)
+            throw std::runtime_error{"io_uring is unavailable on this system"};
+
+        ring_acceptor acc;
+        acc.ring = ring.get();
+
+        int fd = acc.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 or listen(fd, SOMAXCONN) < 0)
+            throw std::runtime_error{"bind/listen failed: {}"_format(strerror(errno))};
+
+        loop->call_get([&] { acc.op = ring->accept_multishot(fd, ring_acceptor::accept_cb, &acc); });
+
+        auto enters_before = loop->call_get([&] { return ring->enters(); });
+        auto start = clock::now();
+        run_clients(local_port(fd), clients, conns);
+
+        while (acc.accepted.load(std::memory_order_acquire) < conns)
+            std::this_thread::yield();
+
+        auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        auto enters = loop->call_get([&] { return ring->enters(); }) - enters_before;
+
+        loop->call_get([&] {
+            ring->cancel(acc.op);
+            ring->submit();
+            close(fd);
+            ring.reset();
+        });
+
+        return {conns / elapsed, enters};
+    }
+#endif
+
+    // Request/response exchanges between two bufferevents over a connected pair of sockets
+    struct exchange
+    {
+        bufferevent* client{nullptr};
+        bufferevent* server{nullptr};
+        size_t left{0};
+        std::promise<void> done;
+
+        static constexpr size_t REQUEST_SIZE{256};
+        static constexpr size_t RESPONSE_SIZE{1024};
+
+        static inline const std::array<uint8_t, RESPONSE_SIZE> bytes{};
+
+        static void server_read(bufferevent* bev, void*)
+        {
+            auto* in = bufferevent_get_input(bev);
+            while (evbuffer_get_length(in) >= REQUEST_SIZE)
+            {
+                evbuffer_drain(in, REQUEST_SIZE);
+                bufferevent_write(bev, bytes.data(), RESPONSE_SIZE);
+            }
+        }
+
+        static void client_read(bufferevent* bev, void* user_arg)
+        {
+            auto& x = *static_cast<exchange*>(user_arg);
+            auto* in = bufferevent_get_input(bev);
+
+            while (evbuffer_get_length(in) >= RESPONSE_SIZE)
+            {
+                evbuffer_drain(in, RESPONSE_SIZE);
+
+                if (--x.left == 0)
+                    return x.done.set_value();
+
+                bufferevent_write(bev, bytes.data(), REQUEST_SIZE);
+            }
+        }
+
+        // Sets up both ends on the loop, flagged the way sessions create their bufferevents on it
+        void open(event_loop& loop, int server_fd, int client_fd)
+        {
+            auto opts = BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS | (loop.lock_free() ? 0 : BEV_OPT_THREADSAFE);
+
+            server = bufferevent_socket_new(loop.loop().get(), server_fd, opts);
+            client = bufferevent_socket_new(loop.loop().get(), client_fd, opts);
+            bufferevent_setcb(server, server_read, nullptr, nullptr, this);
+            bufferevent_setcb(client, client_read, nullptr, nullptr, this);
+            bufferevent_enable(server, EV_READ | EV_WRITE);
+            bufferevent_enable(client, EV_READ | EV_WRITE);
+        }
+
+        void close()
+        {
+            bufferevent_free(client);
+            bufferevent_free(server);
+        }
+    };
+
+    static double cpu_seconds()
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+    }
+
+    // Runs `requests` sequential exchanges on a loop of the given mode, with bufferevents flagged the way sessions
+    // create theirs on it; returns the process CPU time per request, in nanoseconds
+    static double exchange_cost(loop_mode mode, size_t requests)
+    {
+        auto loop = event_loop::make(std::nullopt, std::nullopt, mode);
+        exchange x;
+        x.left = requests;
+
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            throw std::runtime_error{"socketpair failed: {}"_format(strerror(errno))};
+
+        auto start = cpu_seconds();
+
+        loop->call_get([&] {
+            x.open(*loop, fds[0], fds[1]);
+            bufferevent_write(x.client, exchange::bytes.data(), exchange::REQUEST_SIZE);
+        });
+
+        x.done.get_future().get();
+        auto elapsed = cpu_seconds() - start;
+
+        loop->call_get([&] { x.close(); });
+
+        return elapsed * 1e9 / static_cast<double>(requests);
+    }
+
+    // Connected loopback TCP sockets, non-blocking and without Nagle's delay; returns {accepted, connecting} fds
+    static std::array<int, 2> tcp_pair()
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int lfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (bind(lfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 or listen(lfd, 1) < 0)
+            throw std::runtime_error{"bind/listen failed: {}"_format(strerror(errno))};
+
+        addr.sin_port = htons(local_port(lfd));
+
+        int cfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(cfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw std::runtime_error{"connect failed: {}"_format(strerror(errno))};
+
+        int afd = accept(lfd, nullptr, nullptr);
+        close(lfd);
+
+        if (afd < 0)
+            throw std::runtime_error{"accept failed: {}"_format(strerror(errno))};
+
+        for (int fd : {afd, cfd})
+        {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            evutil_make_socket_nonblocking(fd);
+        }
+
+        return {afd, cfd};
+    }
+
+    struct io_result
+    {
+        double requests_per_sec;
+        double syscalls_per_request;
+    };
+
+    // Sequential exchanges over loopback TCP between bufferevents, the libevent path sessions take
+    static io_result bufferevent_exchange(size_t requests)
+    {
+        auto loop = event_loop::make();
+        exchange x;
+        x.left = requests;
+
+        auto [server_fd, client_fd] = tcp_pair();
+        size_t before{0};
+        clock::time_point start;
+
+        loop->call_get([&] {
+            x.open(*loop, server_fd, client_fd);
+
+            before = syscalls.load(std::memory_order_relaxed);
+            start = clock::now();
+            bufferevent_write(x.client, exchange::bytes.data(), exchange::REQUEST_SIZE);
+        });
+
+        x.done.get_future().get();
+        auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        auto calls = syscalls.load(std::memory_order_relaxed) - before;
+
+        loop->call_get([&] { x.close(); });
+
+        return {requests / elapsed, static_cast<double>(calls) / static_cast<double>(requests)};
+    }
+
+#ifdef WSHTTP_USE_IO_URING
+    // The same exchanges between ring_sockets: multishot recv into provided buffers, and writes sent once per iteration
+    struct ring_exchange
+    {
+        std::unique_ptr<ring_socket> client;
+        std::unique_ptr<ring_socket> server;
+        size_t left{0};
+        std::promise<void> done;
+
+        static void server_read(ring_socket& s, void*)
+        {
+            auto* in = s.input();
+            while (evbuffer_get_length(in) >= exchange::REQUEST_SIZE)
+            {
+                evbuffer_drain(in, exchange::REQUEST_SIZE);
+                s.write(exchange::bytes.data(), exchange::RESPONSE_SIZE);
+            }
+        }
+
+        static void client_read(ring_socket& s, void* user_arg)
+        {
+            auto& x = *static_cast<ring_exchange*>(user_arg);
+            auto* in = s.input();
+
+            while (evbuffer_get_length(in) >= exchange::RESPONSE_SIZE)
+            {
+                evbuffer_drain(in, exchange::RESPONSE_SIZE);
+
+                if (--x.left == 0)
+                    return x.done.set_value();
+
+                s.write(exchange::bytes.data(), exchange::REQUEST_SIZE);
+            }
+        }
+
+        static void closed(ring_socket&, short, void* user_arg)
+        {
+            auto& x = *static_cast<ring_exchange*>(user_arg);
+            x.done.set_exception(
+                std::make_exception_ptr(std::runtime_error{"exchange socket closed: {}"_format(strerror(errno))}));
+        }
+    };
+
+    static io_result uring_exchange(size_t requests)
+    {
+        auto loop = event_loop::make();
+        auto ring = loop->call_get([&] { return io_ring::make(*loop); });
+        if (not ring)
+            throw std::runtime_error{"io_uring is unavailable on this system"};
+
+        ring_exchange x;
+        x.left = requests;
+
+        auto [server_fd, client_fd] = tcp_pair();
+        size_t before{0}, enters_before{0};
+        clock::time_point start;
+
+        loop->call_get([&] {
+            x.server = ring_socket::make(*ring, server_fd, ring_exchange::server_read, ring_exchange::closed, &x);
+            x.client = ring_socket::make(*ring, client_fd, ring_exchange::client_read, ring_exchange::closed, &x);
+
+            if (not x.server or not x.client)
+                throw std::runtime_error{"io_uring provided buffer rings are unavailable on this system"};
+
+            before = syscalls.load(std::memory_order_relaxed);
+            enters_before = ring->enters();
+            start = clock::now();
+            x.client->write(exchange::bytes.data(), exchange::REQUEST_SIZE);
+        });
+
+        x.done.get_future().get();
+        auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        auto calls = syscalls.load(std::memory_order_relaxed) - before;
+        calls += loop->call_get([&] { return ring->enters(); }) - enters_before;
+
+        loop->call_get([&] {
+            x.client.reset();
+            x.server.reset();
+            ring->submit();
+            ring.reset();
+        });
+
+        return {requests / elapsed, static_cast<double>(calls) / static_cast<double>(requests)};
+    }
+#endif
+
+    static double percentile(const std::vector<double>& sorted, double p)
+    {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    }
+}  //  namespace wshttp::bench
+
+int main(int argc, char* argv[])
+{
+    using namespace wshttp::bench;
+
+    CLI::App cli{"WSHTTP event loop benchmark"};
+
+    std::string log_level{"warn"};
+    cli.add_option(
+        "-L,--log-level", log_level, "Log verbosity level; one of trace, debug, info, warn, error, or critical");
+
+    size_t producers{4}, jobs{250'000}, samples{2'000}, clients{4}, conns{20'000}, requests{100'000};
+    cli.add_option("-p,--producers", producers, "Number of producer threads");
+    cli.add_option("-n,--jobs", jobs, "Jobs posted per producer thread");
+    cli.add_option("-s,--samples", samples, "Number of wake latency samples");
+    cli.add_option("-c,--clients", clients, "Number of loopback client threads for the accept benchmark");
+    cli.add_option("-a,--accepts", conns, "Number of connections accepted in the accept benchmark");
+    cli.add_option(
+        "-r,--requests", requests, "Number of request/response exchanges in the locking and socket I/O benchmarks");
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    wshttp::log->set_level(log_level);
+
+    fmt::print("cross-thread enqueue ({} producers x {} jobs):\n", producers, jobs);
+    fmt::print("  mutex queue (before): {:8.2f} Mjobs/s\n", queue_throughput<locked_queue>(producers, jobs));
+    fmt::print("  mpsc queue (after):   {:8.2f} Mjobs/s\n", queue_throughput<mpsc_adapter>(producers, jobs));
+    fmt::print("  event_loop::call_soon {:8.2f} Mjobs/s\n", loop_throughput(producers, jobs));
+
+    auto p_lat = call_get_latency<true>(samples);
+    auto s_lat = call_get_latency<false>(samples);
+    fmt::print("call_get round trip ({} samples):\n", samples);
+    fmt::print(
+        "  promise/future (before): p50 {:.1f}us, p99 {:.1f}us\n", percentile(p_lat, 0.5), percentile(p_lat, 0.99));
+    fmt::print(
+        "  stack slot (after):      p50 {:.1f}us, p99 {:.1f}us\n", percentile(s_lat, 0.5), percentile(s_lat, 0.99));
+
+    fmt::print("burst of 10000 jobs: {:.1f}us until drained\n", burst_latency(10'000, 50));
+
+    auto last_core = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    std::vector<double> locked_lat;
+    {
+        locked_loop before;
+        locked_lat = wake_latency(before, samples);
+    }
+    auto lat = wake_latency(*wshttp::event_loop::make(), samples);
+    auto busy_lat = wake_latency(*wshttp::event_loop::make(last_core, wshttp::busy_poll_config{}), samples);
+    fmt::print("wake latency ({} samples):\n", samples);
+    fmt::print(
+        "  mutex queue (before):  p50 {:.1f}us, p99 {:.1f}us, max {:.1f}us\n",
+        percentile(locked_lat, 0.5),
+        percentile(locked_lat, 0.99),
+        locked_lat.back());
+    fmt::print(
+        "  mpsc queue (after):    p50 {:.1f}us, p99 {:.1f}us, max {:.1f}us\n",
+        percentile(lat, 0.5),
+        percentile(lat, 0.99),
+        lat.back());
+    fmt::print(
+        "  busy poll (core {:2}):   p50 {:.1f}us, p99 {:.1f}us, max {:.1f}us\n",
+        last_core,
+        percentile(busy_lat, 0.5),
+        percentile(busy_lat, 0.99),
+        busy_lat.back());
+
+    fmt::print("bufferevent request/response ({} exchanges, CPU per request):\n", requests);
+    fmt::print("  threadsafe (before):      {:7.0f} ns\n", exchange_cost(wshttp::loop_mode::threadsafe, requests));
+    fmt::print("  single-threaded (after):  {:7.0f} ns\n", exchange_cost(wshttp::loop_mode::single_threaded, requests));
+
+    auto ev = evconn_accept(clients, conns);
+    fmt::print("loopback accept ({} clients, {} connections):\n", clients, conns);
+    fmt::print("  evconnlistener:     {:10.0f} conns/s\n", ev.conns_per_sec);
+#ifdef WSHTTP_USE_IO_URING
+    auto ur = uring_accept(clients, conns);
+    fmt::print(
+        "  io_uring multishot: {:10.0f} conns/s, {:.3f} io_uring_enter per conn\n",
+        ur.conns_per_sec,
+        static_cast<double>(ur.enters) / conns);
+#endif
+
+    fmt::print(
+        "loopback TCP request/response ({} exchanges of {}B for {}B):\n",
+        requests,
+        exchange::REQUEST_SIZE,
+        exchange::RESPONSE_SIZE);
+    auto bev = bufferevent_exchange(requests);
+    fmt::print(
+        "  bufferevent:          {:10.0f} req/s, {:.2f} syscalls per request\n",
+        bev.requests_per_sec,
+        bev.syscalls_per_request);
+#ifdef WSHTTP_USE_IO_URING
+    auto rs = uring_exchange(requests);
+    fmt::print(
+        "  io_uring ring_socket: {:10.0f} req/s, {:.2f} syscalls per request\n",
+        rs.requests_per_sec,
+        rs.syscalls_per_request);
+#endif
+}
@@ -0,0 +1,699 @@
+#include "utils.hpp"
+
+#include <event2/buffer.h>
+#include <nghttp2/nghttp2.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+namespace wshttp::bench
+{
+    using clock = std::chrono::steady_clock;
+
+    // Same output threshold as the session send path
+    static constexpr size_t OUTPUT_THRESHOLD{1 << 16};
+
+    static constexpr size_t PAYLOAD_CHUNK{16'384};
+    static const std::array<uint8_t, PAYLOAD_CHUNK> payload{};
+
+    // Where the server's response body comes from, and how its DATA frames get into the output
+    enum class body
+    {
+        copying,       // generated in memory; previous send path (send callback + ustring copy)
+        direct,        // generated in memory; nghttp2_session_mem_send2 + evbuffer_add
+        file_read,     // read() from a file into nghttp2's frame buffer
+        file_segment,  // NGHTTP2_DATA_FLAG_NO_COPY, payload appended by reference to an evbuffer file segment
+    };
+
+    // How the client takes in response body chunks
+    enum class recv_path
+    {
+        copying,   // previous receive path: each chunk copied into a ustring, window updated on receipt
+        borrowed,  // refcounted views into a block taken over from the input, window updated once consumed
+    };
+
+    // One end of an in-memory HTTP/2 connection; `out` is the peer's `in`
+    struct peer
+    {
+        nghttp2_session* session{nullptr};
+        evbuffer* out{nullptr};
+
+        body mode{body::direct};
+        int file_fd{-1};
+        evbuffer_file_segment* file{nullptr};
+        uint64_t file_sent{0};
+
+        size_t response_size{0};
+        size_t received{0};
+        bool done{false};
+
+        // server side: when set, requests are only recorded here, to be responded to outside of nghttp2's callbacks
+        bool defer_responses{false};
+        std::vector<int32_t> requests;
+
+        // Time spent producing DATA frames into `out`, i.e. the send path being measured
+        clock::duration send_time{};
+
+        // client side: body chunks received and not yet handed to the application, as copies or borrowed views
+        recv_path rpath{recv_path::copying};
+        input_block_ptr block;
+        std::deque<ustring> copies;
+        std::deque<recv_chunk> chunks;
+
+        // Time spent taking in DATA frames and handing their payload to the application
+        clock::duration recv_time{};
+
+        ~peer()
+        {
+            nghttp2_session_del(session);
+            if (file)
+                evbuffer_file_segment_free(file);
+        }
+    };
+
+    static nghttp2_nv make_nv(std::string_view name, std::string_view value)
+    {
+        return nghttp2_nv{
+            reinterpret_cast<uint8_t*>(const_cast<char*>(name.data())),
+            reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())),
+            name.size(),
+            value.size(),
+            NGHTTP2_NV_FLAG_NO_COPY_NAME | NGHTTP2_NV_FLAG_NO_COPY_VALUE};
+    }
+
+    static nghttp2_ssize read_payload(
+        nghttp2_session*, int32_t, uint8_t* buf, size_t len, uint32_t* flags, nghttp2_data_source* src, void*)
+    {
+        auto& left = *static_cast<size_t*>(src->ptr);
+        auto n = std::min({len, left, PAYLOAD_CHUNK});
+
+        std::memcpy(buf, payload.data(), n);
+
+        if ((left -= n) == 0)
+            *flags |= NGHTTP2_DATA_FLAG_EOF;
+
+        return static_cast<nghttp2_ssize>(n);
+    }
+
+    static nghttp2_ssize read_file(
+        nghttp2_session*, int32_t, uint8_t* buf, size_t len, uint32_t* flags, nghttp2_data_source* src, void*)
+    {
+        auto n = read(src->fd, buf, len);
+
+        if (n == 0)
+            *flags |= NGHTTP2_DATA_FLAG_EOF;
+
+        if (n < 0)
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+
+        return static_cast<nghttp2_ssize>(n);
+    }
+
+    static nghttp2_ssize read_file_segment(
+        nghttp2_session*, int32_t, uint8_t*, size_t len, uint32_t* flags, nghttp2_data_source* src, void*)
+    {
+        auto& p = *static_cast<peer*>(src->ptr);
+        auto n = std::min<uint64_t>(len, p.response_size - p.file_sent);
+
+        *flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+        if (p.file_sent + n == p.response_size)
+            *flags |= NGHTTP2_DATA_FLAG_EOF;
+
+        return static_cast<nghttp2_ssize>(n);
+    }
+
+    // Same as session_callbacks::send_data_callback, less padding
+    static int send_file_segment(
+        nghttp2_session*, nghttp2_frame*, const uint8_t* framehd, size_t len, nghttp2_data_source* src, void* user_arg)
+    {
+        auto& p = *static_cast<peer*>(user_arg);
+
+        if (evbuffer_get_length(p.out) >= OUTPUT_THRESHOLD)
+            return NGHTTP2_ERR_WOULDBLOCK;
+
+        auto& server = *static_cast<peer*>(src->ptr);
+
+        evbuffer_add(p.out, framehd, 9);
+        if (len > 0)
+            evbuffer_add_file_segment(
+                p.out, server.file, static_cast<ev_off_t>(server.file_sent), static_cast<ev_off_t>(len));
+        server.file_sent += len;
+
+        return 0;
+    }
+
+    static int server_frame_recv(nghttp2_session* session, const nghttp2_frame* frame, void* user_arg)
+    {
+        auto& p = *static_cast<peer*>(user_arg);
+
+        if (frame->hd.type != NGHTTP2_HEADERS or not(frame->hd.flags & NGHTTP2_FLAG_END_STREAM))
+            return 0;
+
+        if (p.defer_responses)
+        {
+            p.requests.push_back(frame->hd.stream_id);
+            return 0;
+        }
+
+        std::array<nghttp2_nv, 1> nva{make_nv(":status", "200")};
+
+        nghttp2_data_provider2 prov{};
+
+        switch (p.mode)
+        {
+            case body::file_read:
+                prov.source.fd = p.file_fd;
+                prov.read_callback = read_file;
+                break;
+            case body::file_segment:
+                prov.source.ptr = &p;
+                prov.read_callback = read_file_segment;
+                break;
+            default:
+                prov.source.ptr = &p.response_size;
+                prov.read_callback = read_payload;
+        }
+
+        return nghttp2_submit_response2(session, frame->hd.stream_id, nva.data(), nva.size(), &prov);
+    }
+
+    static int client_data_recv(nghttp2_session*, uint8_t, int32_t, const uint8_t* data, size_t len, void* user_arg)
+    {
+        auto& p = *static_cast<peer*>(user_arg);
+        p.received += len;
+
+        if (p.rpath == recv_path::copying)
+            p.copies.emplace_back(data, len);
+        else
+            p.chunks.push_back({p.block, uspan{data, len}});
+
+        return 0;
+    }
+
+    static int client_stream_close(nghttp2_session*, int32_t, uint32_t, void* user_arg)
+    {
+        static_cast<peer*>(user_arg)->done = true;
+        return 0;
+    }
+
+    // Reproduction of the previous send path, kept as the baseline: nghttp2_session_send with a send callback that
+    // copies each frame into a fresh ustring, which is then copied again into the output buffer
+    static nghttp2_ssize copying_send(nghttp2_session*, const uint8_t* data, size_t len, int, void* user_arg)
+    {
+        auto& p = *static_cast<peer*>(user_arg);
+
+        if (evbuffer_get_length(p.out) >= OUTPUT_THRESHOLD)
+            return NGHTTP2_ERR_WOULDBLOCK;
+
+        ustring frame{data, len};
+        evbuffer_add(p.out, frame.data(), frame.size());
+        return static_cast<nghttp2_ssize>(frame.size());
+    }
+
+    static void send_copying(peer& p)
+    {
+        auto start = clock::now();
+        nghttp2_session_send(p.session);
+        p.send_time += clock::now() - start;
+    }
+
+    // Current send path: nghttp2_session_mem_send2, appending each chunk straight from nghttp2's buffer
+    static void send_direct(peer& p)
+    {
+        auto start = clock::now();
+
+        while (evbuffer_get_length(p.out) < OUTPUT_THRESHOLD)
+        {
+            const uint8_t* data{nullptr};
+            auto len = nghttp2_session_mem_send2(p.session, &data);
+
+            if (len <= 0)
+                break;
+
+            evbuffer_add(p.out, data, static_cast<size_t>(len));
+        }
+
+        p.send_time += clock::now() - start;
+    }
+
+    // Output produced by a burst of responses: send passes that produced frames, appends to the output, and the TLS
+    // records a bufferevent_openssl write of the result would take (one SSL_write per buffer chain)
+    struct output_counts
+    {
+        size_t passes{0};
+        size_t appends{0};
+        size_t records{0};
+    };
+
+    // send_direct, counting what it appends
+    static void send_counted(peer& p, output_counts& c)
+    {
+        size_t n{0};
+
+        while (evbuffer_get_length(p.out) < OUTPUT_THRESHOLD)
+        {
+            const uint8_t* data{nullptr};
+            auto len = nghttp2_session_mem_send2(p.session, &data);
+
+            if (len <= 0)
+                break;
+
+            evbuffer_add(p.out, data, static_cast<size_t>(len));
+            ++n;
+        }
+
+        if (n > 0)
+        {
+            ++c.passes;
+            c.appends += n;
+        }
+    }
+
+    static void count_records(evbuffer* out, output_counts& c)
+    {
+        std::vector<evbuffer_iovec> vecs(static_cast<size_t>(evbuffer_peek(out, -1, nullptr, nullptr, 0)));
+        evbuffer_peek(out, -1, nullptr, vecs.data(), static_cast<int>(vecs.size()));
+
+        for (auto& v : vecs)
+            c.records += (v.iov_len + PAYLOAD_CHUNK - 1) / PAYLOAD_CHUNK;
+    }
+
+    static void feed(peer& p, evbuffer* in)
+    {
+        std::array<evbuffer_iovec, 16> vecs;
+        auto n = evbuffer_peek(in, -1, nullptr, vecs.data(), vecs.size());
+
+        for (int i = 0; i < std::min<int>(n, vecs.size()); ++i)
+            nghttp2_session_mem_recv2(p.session, static_cast<const uint8_t*>(vecs[i].iov_base), vecs[i].iov_len);
+    }
+
+    static void recv_all(peer& p, evbuffer* in)
+    {
+        feed(p, in);
+        evbuffer_drain(in, evbuffer_get_length(in));
+    }
+
+    // Same as session_base::read_session_data: takes the input over as a block for received chunks to borrow from,
+    // then lets the application consume everything it was handed
+    static void recv_body(peer& p, evbuffer* in)
+    {
+        auto start = clock::now();
+
+        if (p.rpath == recv_path::copying)
+        {
+            recv_all(p, in);
+            p.copies.clear();
+        }
+        else
+        {
+            if (not p.block or p.block.use_count() > 1)
+                p.block = input_block_ptr{evbuffer_new(), deleters::_evbuffer{}};
+
+            evbuffer_add_buffer(p.block.get(), in);
+            feed(p, p.block.get());
+
+            for (auto& c : p.chunks)
+                nghttp2_session_consume(p.session, 1, c.data.size());
+            p.chunks.clear();
+
+            evbuffer_drain(p.block.get(), evbuffer_get_length(p.block.get()));
+        }
+
+        p.recv_time += clock::now() - start;
+    }
+
+    static nghttp2_ssize read_length(nghttp2_session*, uint8_t, int32_t, int32_t, int32_t, uint32_t max_frame, void*)
+    {
+        return static_cast<nghttp2_ssize>(max_frame);
+    }
+
+    // Creates both sessions, each advertising `settings`, and queues the client's request
+    static void connect(peer& server, peer& client, const h2_settings& settings)
+    {
+        nghttp2_session_callbacks* cbs;
+
+        nghttp2_session_callbacks_new(&cbs);
+        nghttp2_session_callbacks_set_on_frame_recv_callback(cbs, server_frame_recv);
+        nghttp2_session_callbacks_set_data_source_read_length_callback2(cbs, read_length);
+        if (server.mode == body::copying)
+            nghttp2_session_callbacks_set_send_callback2(cbs, copying_send);
+        if (server.mode == body::file_segment)
+            nghttp2_session_callbacks_set_send_data_callback(cbs, send_file_segment);
+        nghttp2_session_server_new(&server.session, cbs, &server);
+        nghttp2_session_callbacks_del(cbs);
+
+        nghttp2_session_callbacks_new(&cbs);
+        nghttp2_session_callbacks_set_on_data_chunk_recv_callback(cbs, client_data_recv);
+        nghttp2_session_callbacks_set_on_stream_close_callback(cbs, client_stream_close);
+        nghttp2_option* opt;
+        nghttp2_option_new(&opt);
+        nghttp2_option_set_no_auto_window_update(opt, client.rpath == recv_path::borrowed);
+        nghttp2_session_client_new2(&client.session, cbs, &client, opt);
+        nghttp2_option_del(opt);
+        nghttp2_session_callbacks_del(cbs);
+
+        // same as session_base::submit_settings
+        auto entries = settings.entries();
+        for (auto* p : {&server, &client})
+        {
+            nghttp2_submit_settings(p->session, NGHTTP2_FLAG_NONE, entries.data(), entries.size());
+            if (settings.connection_window_size)
+                nghttp2_session_set_local_window_size(
+                    p->session, NGHTTP2_FLAG_NONE, 0, static_cast<int32_t>(*settings.connection_window_size));
+        }
+
+        std::array<nghttp2_nv, 4> nva{
+            make_nv(":method", "GET"),
+            make_nv(":scheme", "https"),
+            make_nv(":authority", "bench"),
+            make_nv(":path", "/")};
+        nghttp2_submit_request2(client.session, nullptr, nva.data(), nva.size(), nullptr, nullptr);
+    }
+
+    struct result
+    {
+        double send_mbps;
+        double total_mbps;
+    };
+
+    // Transfers one response of `size` bytes from an in-memory server to client, returning the throughput of the
+    // server's send path alone and of the transfer as a whole. File bodies are read from `fd`, which must hold `size`
+    // bytes; page cache misses while mapping a file segment are only counted in the end to end figure.
+    static result data_transfer(body mode, size_t size, int fd = -1)
+    {
+        peer server, client;
+        std::unique_ptr<evbuffer, decltype(&evbuffer_free)> s2c{evbuffer_new(), evbuffer_free},
+            c2s{evbuffer_new(), evbuffer_free};
+
+        server.out = s2c.get();
+        server.mode = mode;
+        server.response_size = size;
+        client.out = c2s.get();
+
+        if (mode == body::file_read)
+        {
+            lseek(fd, 0, SEEK_SET);
+            server.file_fd = fd;
+        }
+        else if (mode == body::file_segment)
+            server.file = evbuffer_file_segment_new(fd, 0, static_cast<ev_off_t>(size), 0);
+
+        // open the flow control windows all the way, so that the transfer is bound by the send path
+        h2_settings wide;
+        wide.initial_window_size = wide.connection_window_size = NGHTTP2_MAX_WINDOW_SIZE;
+        connect(server, client, wide);
+
+        auto start = clock::now();
+
+        while (not client.done)
+        {
+            send_direct(client);
+            recv_all(server, c2s.get());
+            mode == body::copying ? send_copying(server) : send_direct(server);
+            recv_all(client, s2c.get());
+        }
+
+        auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+        if (client.received != size)
+            throw std::runtime_error{"Transfer incomplete: received {}B of {}B"_format(client.received, size)};
+        auto mb = static_cast<double>(client.received) / 1e6;
+
+        return {mb / std::chrono::duration<double>(server.send_time).count(), mb / elapsed};
+    }
+
+    // Transfers one in-memory response of `size` bytes, returning the throughput of the client's receive path alone
+    // and of the transfer as a whole. Windows are left at the RFC defaults, so that window updates are part of it.
+    static result recv_transfer(recv_path rpath, size_t size)
+    {
+        peer server, client;
+        std::unique_ptr<evbuffer, decltype(&evbuffer_free)> s2c{evbuffer_new(), evbuffer_free},
+            c2s{evbuffer_new(), evbuffer_free};
+
+        server.out = s2c.get();
+        server.response_size = size;
+        client.out = c2s.get();
+        client.rpath = rpath;
+
+        h2_settings wide;
+        wide.max_frame_size = 1 << 16;
+        connect(server, client, wide);
+
+        auto start = clock::now();
+
+        while (not client.done)
+        {
+            send_direct(client);
+            recv_all(server, c2s.get());
+            send_direct(server);
+            recv_body(client, s2c.get());
+        }
+
+        auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+        if (client.received != size)
+            throw std::runtime_error{"Transfer incomplete: received {}B of {}B"_format(client.received, size)};
+        auto mb = static_cast<double>(client.received) / 1e6;
+
+        return {mb / std::chrono::duration<double>(client.recv_time).count(), mb / elapsed};
+    }
+
+    struct burst_result
+    {
+        double passes;
+        double appends;
+        double records;
+        double ns;
+    };
+
+    // Serves `rounds` bursts of `burst` concurrent requests with small responses, submitted one at a time the way
+    // handlers completing in the same loop iteration would. Eager sending runs a send pass after every submission (the
+    // previous behavior); coalesced sending runs one per burst, as the loop's end-of-iteration flush does. Returns the
+    // per-request output counts and server time.
+    static burst_result burst_transfer(bool coalesced, size_t burst, size_t rounds, size_t response_size)
+    {
+        peer server, client;
+        std::unique_ptr<evbuffer, decltype(&evbuffer_free)> s2c{evbuffer_new(), evbuffer_free},
+            c2s{evbuffer_new(), evbuffer_free};
+
+        server.out = s2c.get();
+        server.defer_responses = true;
+        client.out = c2s.get();
+
+        connect(server, client, h2_settings{});
+
+        // settle the handshake, and the request `connect` queued
+        for (int i = 0; i < 2; ++i)
+        {
+            send_direct(client);
+            recv_all(server, c2s.get());
+            send_direct(server);
+            recv_all(client, s2c.get());
+        }
+        server.requests.clear();
+
+        std::array<nghttp2_nv, 4> req{
+            make_nv(":method", "GET"),
+            make_nv(":scheme", "https"),
+            make_nv(":authority", "bench"),
+            make_nv(":path", "/")};
+        std::array<nghttp2_nv, 1> res{make_nv(":status", "200")};
+        std::vector<size_t> left(burst);
+
+        output_counts counts;
+        clock::duration elapsed{};
+
+        for (size_t r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < burst; ++i)
+                nghttp2_submit_request2(client.session, nullptr, req.data(), req.size(), nullptr, nullptr);
+            send_direct(client);
+            recv_all(server, c2s.get());
+
+            auto start = clock::now();
+
+            for (size_t i = 0; i < server.requests.size(); ++i)
+            {
+                left[i] = response_size;
+
+                nghttp2_data_provider2 prov{};
+                prov.source.ptr = &left[i];
+                prov.read_callback = read_payload;
+                nghttp2_submit_response2(server.session, server.requests[i], res.data(), res.size(), &prov);
+
+                if (not coalesced)
+                    send_counted(server, counts);
+            }
+
+            if (coalesced)
+                send_counted(server, counts);
+
+            elapsed += clock::now() - start;
+
+            count_records(s2c.get(), counts);
+            server.requests.clear();
+            recv_all(client, s2c.get());
+        }
+
+        auto n = static_cast<double>(burst * rounds);
+
+        return {
+            static_cast<double>(counts.passes) / n,
+            static_cast<double>(counts.appends) / n,
+            static_cast<double>(counts.records) / n,
+            static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / n};
+    }
+
+    // One direction of an emulated link of unlimited bandwidth: bytes reach the receiver `delay` after being sent
+    struct delay_line
+    {
+        clock::duration delay;
+        std::deque<std::pair<clock::time_point, std::vector<uint8_t>>> in_flight;
+
+        void push(evbuffer* from)
+        {
+            if (auto len = evbuffer_get_length(from); len > 0)
+            {
+                std::vector<uint8_t> bytes(len);
+                evbuffer_remove(from, bytes.data(), len);
+                in_flight.emplace_back(clock::now() + delay, std::move(bytes));
+            }
+        }
+
+        // Returns whether anything was delivered
+        bool deliver(peer& to)
+        {
+            bool any{false};
+
+            for (auto now = clock::now(); not in_flight.empty() and in_flight.front().first <= now; any = true)
+            {
+                auto& bytes = in_flight.front().second;
+                nghttp2_session_mem_recv2(to.session, bytes.data(), bytes.size());
+                in_flight.pop_front();
+            }
+
+            return any;
+        }
+
+        clock::time_point next_arrival() const
+        {
+            return in_flight.empty() ? clock::time_point::max() : in_flight.front().first;
+        }
+    };
+
+    // Streams an unbounded response for `duration` over a link with round trip time `rtt`, returning the throughput
+    // the client received at, in MB/s
+    static double rtt_transfer(clock::duration rtt, const h2_settings& settings, clock::duration duration)
+    {
+        peer server, client;
+        std::unique_ptr<evbuffer, decltype(&evbuffer_free)> s2c{evbuffer_new(), evbuffer_free},
+            c2s{evbuffer_new(), evbuffer_free};
+
+        server.out = s2c.get();
+        server.response_size = std::numeric_limits<size_t>::max();
+        client.out = c2s.get();
+
+        connect(server, client, settings);
+
+        delay_line up{rtt / 2, {}}, down{rtt / 2, {}};
+        auto end = clock::now() + duration;
+
+        while (clock::now() < end)
+        {
+            send_direct(client);
+            send_direct(server);
+            bool sent = evbuffer_get_length(c2s.get()) > 0 or evbuffer_get_length(s2c.get()) > 0;
+            up.push(c2s.get());
+            down.push(s2c.get());
+
+            // once both sides are window-bound, nothing moves until the next delivery
+            if (not up.deliver(server) and not down.deliver(client) and not sent)
+                std::this_thread::sleep_until(std::min({up.next_arrival(), down.next_arrival(), end}));
+        }
+
+        return static_cast<double>(client.received) / 1e6 / std::chrono::duration<double>(duration).count();
+    }
+}  //  namespace wshttp::bench
+
+int main(int argc, char* argv[])
+{
+    using namespace wshttp::bench;
+
+    CLI::App cli{"WSHTTP session send path benchmark"};
+
+    size_t size_mb{512};
+    cli.add_option("-m,--megabytes", size_mb, "Size of the DATA transfer, in MB");
+
+    size_t duration_ms{1'000};
+    cli.add_option("-d,--duration", duration_ms, "Duration of each emulated RTT transfer, in milliseconds");
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    auto size = size_mb * 1'000'000;
+
+    auto print = [](std::string_view what, result r) {
+        fmt::print("  {:<34} send path {:8.1f} MB/s, end to end {:8.1f} MB/s\n", what, r.send_mbps, r.total_mbps);
+    };
+
+    fmt::print("DATA transfer of {}MB, in memory:\n", size_mb);
+    print("send callback + ustring (before):", data_transfer(body::copying, size));
+    print("mem_send2 + evbuffer_add (after):", data_transfer(body::direct, size));
+
+    // the file is written up front, so that both runs are served from the page cache
+    std::string tmpl{"/tmp/wshttp-bench-XXXXXX"};
+    auto fd = mkstemp(tmpl.data());
+    if (fd < 0)
+        return 1;
+    unlink(tmpl.c_str());
+
+    for (size_t left = size; left > 0;)
+        left -= write(fd, payload.data(), std::min(left, payload.size()));
+
+    auto print_recv = [](std::string_view what, result r) {
+        fmt::print("  {:<34} recv path {:8.1f} MB/s, end to end {:8.1f} MB/s\n", what, r.send_mbps, r.total_mbps);
+    };
+
+    fmt::print("DATA reception of {}MB, in memory:\n", size_mb);
+    print_recv("ustring copy per chunk (before):", recv_transfer(recv_path::copying, size));
+    print_recv("refcounted chunk views (after):", recv_transfer(recv_path::borrowed, size));
+
+    auto print_burst = [](std::string_view what, burst_result r) {
+        fmt::print(
+            "  {:<34} {:5.2f} send passes, {:5.2f} appends, {:5.2f} TLS records, {:7.0f} ns per request\n",
+            what,
+            r.passes,
+            r.appends,
+            r.records,
+            r.ns);
+    };
+
+    fmt::print("bursts of 32 requests with 1KB responses, per request:\n");
+    print_burst("send pass per submission (before):", burst_transfer(false, 32, 1000, 1024));
+    print_burst("one flush per iteration (after):", burst_transfer(true, 32, 1000, 1024));
+
+    fmt::print("file response of {}MB, from the page cache:\n", size_mb);
+    print("read() into frame buffer (before):", data_transfer(body::file_read, size, fd));
+    print("NO_COPY file segment (after):", data_transfer(body::file_segment, size, fd));
+
+    close(fd);
+
+    fmt::print("bulk transfer over an emulated link, {}ms per RTT:\n", duration_ms);
+    for (auto rtt : {1ms, 10ms, 50ms, 100ms})
+        fmt::print(
+            "  rtt {:3}ms: RFC default windows {:9.1f} MB/s, bulk() profile {:9.1f} MB/s\n",
+            rtt.count(),
+            rtt_transfer(rtt, wshttp::h2_settings{}, std::chrono::milliseconds{duration_ms}),
+            rtt_transfer(rtt, wshttp::h2_settings::bulk(), std::chrono::milliseconds{duration_ms}));
+}
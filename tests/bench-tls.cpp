@@ -0,0 +1,154 @@
+#include "utils.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace wshttp::bench
+{
+    using clock = std::chrono::steady_clock;
+
+    static bool step(SSL* ssl)
+    {
+        if (auto rv = SSL_do_handshake(ssl); rv == 1)
+            return true;
+        else if (auto err = SSL_get_error(ssl, rv); err != SSL_ERROR_WANT_READ and err != SSL_ERROR_WANT_WRITE)
+            throw std::runtime_error{"Handshake failed: {}"_format(ERR_error_string(ERR_get_error(), nullptr))};
+
+        return false;
+    }
+
+    /** Runs one handshake between an outbound SSL of `ctx` and an inbound one of `server` over an in-memory BIO pair,
+        offering the session cached for the host as outbound sessions do; returns the time until both sides completed.
+        The client then reads once more, as a session would, to take in the tickets sent after the handshake.
+     */
+    static clock::duration handshake(app_context& ctx, app_context& server_ctx)
+    {
+        std::unique_ptr<SSL, decltype(&SSL_free)> client{SSL_new(ctx.O()), SSL_free},
+            server{SSL_new(server_ctx.I()), SSL_free};
+        BIO *cbio, *sbio;
+        BIO_new_bio_pair(&cbio, 0, &sbio, 0);
+        SSL_set_bio(client.get(), cbio, cbio);
+        SSL_set_bio(server.get(), sbio, sbio);
+
+        // the certificate is self-signed
+        SSL_set_verify(client.get(), SSL_VERIFY_NONE, nullptr);
+        SSL_set_connect_state(client.get());
+        SSL_set_accept_state(server.get());
+
+        auto start = clock::now();
+
+        ctx.client_sessions().resume(client.get(), "bench:{}"_format(HTTPS_PORT));
+
+        for (bool c = false, s = false; not(c and s);)
+        {
+            c = c or step(client.get());
+            s = s or step(server.get());
+        }
+
+        auto elapsed = clock::now() - start;
+
+        ctx.client_sessions().record(client.get());
+
+        uint8_t byte;
+        SSL_read(client.get(), &byte, 1);
+
+        // as sessions close theirs (see `deleters::_ssl`); freed without a shutdown, the session would be dropped
+        SSL_shutdown(client.get());
+        SSL_shutdown(server.get());
+
+        return elapsed;
+    }
+
+    struct handshake_result
+    {
+        double p50_us;
+        double p99_us;
+        resumption_stats stats;
+    };
+
+    /** Runs `n` handshakes from one client context against `servers` server contexts taking turns, each handing out
+        tickets under `keys` (or keys of its own if null); `rotate_every` rotates the keys every so many handshakes.
+     */
+    static handshake_result handshakes(
+        const std::shared_ptr<ssl_creds>& creds,
+        size_t cached,
+        size_t n,
+        size_t servers = 1,
+        std::shared_ptr<ticket_keys> keys = ticket_keys::make(),
+        size_t rotate_every = 0)
+    {
+        auto ctx = app_context::make(creds);
+        ctx->client_sessions().set_capacity(cached);
+
+        std::vector<std::shared_ptr<app_context>> server_ctxs;
+        for (size_t i = 0; i < servers; ++i)
+        {
+            auto& s = server_ctxs.emplace_back(app_context::make(creds));
+            s->configure_server_resumption(keys ? keys : ticket_keys::make(), 0);
+        }
+
+        std::vector<double> us;
+        us.reserve(n);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (rotate_every and i and i % rotate_every == 0)
+                keys->rotate();
+
+            us.push_back(
+                std::chrono::duration<double, std::micro>(handshake(*ctx, *server_ctxs[i % servers])).count());
+        }
+
+        std::sort(us.begin(), us.end());
+
+        return {us[us.size() / 2], us[std::min(us.size() - 1, us.size() * 99 / 100)], ctx->client_sessions().stats()};
+    }
+}  //  namespace wshttp::bench
+
+int main(int argc, char* argv[])
+{
+    using namespace wshttp::bench;
+
+    CLI::App cli{"WSHTTP TLS handshake benchmark"};
+
+    std::string log_level{"warn"};
+    cli.add_option(
+        "-L,--log-level", log_level, "Log verbosity level; one of trace, debug, info, warn, error, or critical");
+
+    size_t n{2'000};
+    cli.add_option("-n,--handshakes", n, "Number of handshakes per configuration");
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    wshttp::log->set_level(log_level);
+
+    auto creds = wshttp::make_test_creds(wshttp::fs::temp_directory_path(), "bench-tls");
+
+    auto print = [](std::string_view what, handshake_result r) {
+        fmt::print(
+            "  {:<28} p50 {:7.1f}us, p99 {:7.1f}us ({} resumed, {} full)\n",
+            what,
+            r.p50_us,
+            r.p99_us,
+            r.stats.hits,
+            r.stats.misses);
+    };
+
+    fmt::print("in-memory TLS handshakes to one host ({} each):\n", n);
+    print("no session cache (before):", handshakes(creds, 0, n));
+    print("session cache (after):", handshakes(creds, wshttp::tls_resumption{}.client_sessions, n));
+
+    auto cached = wshttp::tls_resumption{}.client_sessions;
+
+    fmt::print("\nsession tickets across key rotation and listener shards ({} each):\n", n);
+    print("rotating every 100:", handshakes(creds, cached, n, 1, wshttp::ticket_keys::make(), 100));
+    print("4 shards, own keys:", handshakes(creds, cached, n, 4, nullptr));
+    print("4 shards, shared keys:", handshakes(creds, cached, n, 4, wshttp::ticket_keys::make()));
+}
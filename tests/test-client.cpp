@@ -32,6 +32,7 @@ int main(int argc, char* argv[])
 
     std::shared_ptr<wshttp::endpoint> ep;
     std::shared_ptr<wshttp::ssl_creds> creds;
+    size_t received{0};
 
     auto loop = wshttp::event_loop::make();
     if (not key_path.empty() and not cert_path.empty())
@@ -46,6 +47,19 @@ int main(int argc, char* argv[])
             ep->listen(5544);
         // ep->test_parse_method("https://www.google.com");
         ep->connect("https://www.google.com");
+
+        ep->submit(
+            "www.google.com",
+            wshttp::request{},
+            {.on_headers =
+                 [](const wshttp::response& r) {
+                     wshttp::log->info("Response status {} with {} headers", r.status, r.headers.size());
+                 },
+             .on_data = [&received](wshttp::uspan chunk) { received += chunk.size(); },
+             .on_close =
+                 [&received](const wshttp::response& r) {
+                     wshttp::log->info("Response complete: {}B of body, error code {}", received, r.error_code);
+                 }});
     }
     catch (const std::exception& e)
     {
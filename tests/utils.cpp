@@ -1,6 +1,50 @@
 #include "utils.hpp"
 
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <cstdio>
+
 namespace wshttp
 {
-    //
+    std::shared_ptr<ssl_creds> make_test_creds(const fs::path& dir, std::string_view name)
+    {
+        auto key = dir / "{}.key"_format(name), cert = dir / "{}.crt"_format(name);
+
+        std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> pkey{EVP_EC_gen("P-256"), EVP_PKEY_free};
+        std::unique_ptr<X509, decltype(&X509_free)> x509{X509_new(), X509_free};
+
+        if (not pkey or not x509)
+            throw std::runtime_error{
+                "Failed to generate test key/cert: {}"_format(ERR_error_string(ERR_get_error(), nullptr))};
+
+        ASN1_INTEGER_set(X509_get_serialNumber(x509.get()), 1);
+        X509_gmtime_adj(X509_getm_notBefore(x509.get()), 0);
+        X509_gmtime_adj(X509_getm_notAfter(x509.get()), 3600);
+        X509_set_pubkey(x509.get(), pkey.get());
+        X509_NAME_add_entry_by_txt(
+            X509_get_subject_name(x509.get()),
+            "CN",
+            MBSTRING_ASC,
+            reinterpret_cast<const unsigned char*>(std::string{name}.c_str()),
+            -1,
+            -1,
+            0);
+        X509_set_issuer_name(x509.get(), X509_get_subject_name(x509.get()));
+        X509_sign(x509.get(), pkey.get(), EVP_sha256());
+
+        auto write = [](const fs::path& p, auto&& f) {
+            std::unique_ptr<FILE, decltype(&fclose)> fp{fopen(p.c_str(), "w"), fclose};
+            if (not fp or f(fp.get()) != 1)
+                throw std::runtime_error{"Failed to write {}"_format(p.string())};
+        };
+
+        write(key, [&](FILE* fp) {
+            return PEM_write_PrivateKey(fp, pkey.get(), nullptr, nullptr, 0, nullptr, nullptr);
+        });
+        write(cert, [&](FILE* fp) { return PEM_write_X509(fp, x509.get()); });
+
+        return ssl_creds::make(key.string(), cert.string());
+    }
 }  //  namespace wshttp
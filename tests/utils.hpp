@@ -17,4 +17,7 @@ namespace wshttp
         signal_status = s;
     }
 
+    // Writes a throwaway P-256 key and self-signed certificate, named `name`, into `dir`
+    std::shared_ptr<ssl_creds> make_test_creds(const fs::path& dir, std::string_view name);
+
 }  //  namespace wshttp